@@ -0,0 +1,337 @@
+//
+// File: AlignmentCache.cpp
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "AlignmentCache.h"
+#include "SiteFilterTools.h"
+
+// From the STL:
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// From bpp-core:
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Exceptions.h>
+#include <Bpp/Io/FileTools.h>
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+
+namespace
+{
+const char CACHE_MAGIC[8] = { 'B', 'P', 'P', 'C', 'A', 'C', 'H', 'E' };
+const uint32_t CACHE_VERSION = 1;
+
+const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+void hashBytes(uint64_t& hash, const char* bytes, size_t length)
+{
+  for (size_t i = 0; i < length; ++i)
+  {
+    hash ^= static_cast<unsigned char>(bytes[i]);
+    hash *= FNV_PRIME;
+  }
+}
+
+/**
+ * @brief Hash a string, including a terminal null character so that consecutive strings cannot be confused.
+ */
+void hashString(uint64_t& hash, const string& s)
+{
+  hashBytes(hash, s.c_str(), s.size() + 1);
+}
+
+template<class T>
+void writeValue(ostream& out, const T& value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<class T>
+T readValue(istream& in)
+{
+  T value;
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+  if (!in)
+    throw Exception("AlignmentCache::read. Unexpected end of file.");
+  return value;
+}
+
+void writeString(ostream& out, const string& s)
+{
+  writeValue<uint64_t>(out, s.size());
+  out.write(s.c_str(), static_cast<streamsize>(s.size()));
+}
+
+string readString(istream& in)
+{
+  uint64_t size = readValue<uint64_t>(in);
+  string s(static_cast<size_t>(size), '\0');
+  in.read(&s[0], static_cast<streamsize>(size));
+  if (!in)
+    throw Exception("AlignmentCache::read. Unexpected end of file.");
+  return s;
+}
+}
+
+/******************************************************************************/
+
+uint64_t AlignmentCache::getKey(const string& path, const map<string, string>& params, bool gapAsUnknown)
+{
+  uint64_t hash = FNV_OFFSET;
+  ifstream file(path.c_str(), ios::in | ios::binary);
+  if (!file)
+    throw IOException("AlignmentCache::getKey. Cannot read file " + path);
+  vector<char> buffer(1 << 16);
+  while (file)
+  {
+    file.read(&buffer[0], static_cast<streamsize>(buffer.size()));
+    hashBytes(hash, &buffer[0], static_cast<size_t>(file.gcount()));
+  }
+  for (map<string, string>::const_iterator it = params.begin(); it != params.end(); ++it)
+  {
+    const string& name = it->first;
+    if (name == "alphabet" || name == "genetic_code" ||
+        (name.compare(0, 15, "input.sequence.") == 0 && name.compare(0, 20, "input.sequence.cache") != 0) ||
+        name.compare(0, 11, "input.site.") == 0)
+    {
+      hashString(hash, name);
+      hashString(hash, it->second);
+    }
+  }
+  hashString(hash, gapAsUnknown ? "gapAsUnknown" : "");
+  return hash;
+}
+
+/******************************************************************************/
+
+bool AlignmentCache::isCacheFile(const string& path)
+{
+  ifstream in(path.c_str(), ios::in | ios::binary);
+  char magic[sizeof(CACHE_MAGIC)];
+  in.read(magic, sizeof(magic));
+  return in && equal(magic, magic + sizeof(magic), CACHE_MAGIC);
+}
+
+/******************************************************************************/
+
+VectorSiteContainer* AlignmentCache::read(const string& path, uint64_t key, const Alphabet* alphabet)
+{
+  if (!FileTools::fileExists(path))
+    return 0;
+  ifstream in(path.c_str(), ios::in | ios::binary);
+  char magic[sizeof(CACHE_MAGIC)];
+  in.read(magic, sizeof(magic));
+  if (!in || !equal(magic, magic + sizeof(magic), CACHE_MAGIC))
+    throw Exception("AlignmentCache::read. Not a cache file: " + path);
+  if (readValue<uint32_t>(in) != CACHE_VERSION || readValue<uint64_t>(in) != key)
+    return 0;
+  if (readString(in) != alphabet->getAlphabetType())
+    return 0;
+
+  size_t nbSequences = static_cast<size_t>(readValue<uint64_t>(in));
+  vector<string> names(nbSequences);
+  for (size_t j = 0; j < nbSequences; ++j)
+  {
+    names[j] = readString(in);
+  }
+  size_t nbPatterns = static_cast<size_t>(readValue<uint64_t>(in));
+  vector< vector<int> > patterns(nbPatterns, vector<int>(nbSequences));
+  for (size_t p = 0; p < nbPatterns; ++p)
+  {
+    for (size_t j = 0; j < nbSequences; ++j)
+    {
+      patterns[p][j] = readValue<int32_t>(in);
+    }
+  }
+  // Weights are not needed to rebuild the alignment, but are checked for consistency:
+  vector<uint32_t> weights(nbPatterns);
+  for (size_t p = 0; p < nbPatterns; ++p)
+  {
+    weights[p] = readValue<uint32_t>(in);
+  }
+  size_t nbSites = static_cast<size_t>(readValue<uint64_t>(in));
+  unique_ptr<VectorSiteContainer> sites(new VectorSiteContainer(names, alphabet));
+  vector<uint32_t> counts(nbPatterns, 0);
+  for (size_t i = 0; i < nbSites; ++i)
+  {
+    uint32_t p = readValue<uint32_t>(in);
+    int32_t position = readValue<int32_t>(in);
+    if (p >= nbPatterns)
+      throw Exception("AlignmentCache::read. Invalid pattern index in " + path);
+    counts[p]++;
+    sites->addSite(Site(patterns[p], alphabet, position), false);
+  }
+  if (counts != weights)
+    throw Exception("AlignmentCache::read. Pattern weights do not match sites in " + path);
+  return sites.release();
+}
+
+/******************************************************************************/
+
+void AlignmentCache::write(const string& path, uint64_t key, const SiteContainer& sites)
+{
+  size_t nbSequences = sites.getNumberOfSequences();
+  size_t nbSites = sites.getNumberOfSites();
+
+  // Compress sites into patterns, in order of first occurrence:
+  map<vector<int>, uint32_t> patternIndex;
+  vector< map<vector<int>, uint32_t>::const_iterator > patterns;
+  vector<uint32_t> weights;
+  vector<uint32_t> sitePatterns(nbSites);
+  for (size_t i = 0; i < nbSites; ++i)
+  {
+    const vector<int>& states = sites.getSite(i).getContent();
+    pair<map<vector<int>, uint32_t>::iterator, bool> inserted =
+      patternIndex.insert(make_pair(states, static_cast<uint32_t>(patterns.size())));
+    if (inserted.second)
+    {
+      patterns.push_back(inserted.first);
+      weights.push_back(0);
+    }
+    sitePatterns[i] = inserted.first->second;
+    weights[sitePatterns[i]]++;
+  }
+
+  // The file is written under a temporary name first, so that an interrupted write never leaves a truncated cache:
+  string tmpPath = path + ".tmp";
+  ofstream out(tmpPath.c_str(), ios::out | ios::binary);
+  if (!out)
+    throw IOException("AlignmentCache::write. Cannot write file " + tmpPath);
+  out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  writeValue<uint32_t>(out, CACHE_VERSION);
+  writeValue<uint64_t>(out, key);
+  writeString(out, sites.getAlphabet()->getAlphabetType());
+  writeValue<uint64_t>(out, nbSequences);
+  vector<string> names = sites.getSequencesNames();
+  for (size_t j = 0; j < nbSequences; ++j)
+  {
+    writeString(out, names[j]);
+  }
+  writeValue<uint64_t>(out, patterns.size());
+  for (size_t p = 0; p < patterns.size(); ++p)
+  {
+    const vector<int>& states = patterns[p]->first;
+    for (size_t j = 0; j < nbSequences; ++j)
+    {
+      writeValue<int32_t>(out, states[j]);
+    }
+  }
+  for (size_t p = 0; p < weights.size(); ++p)
+  {
+    writeValue<uint32_t>(out, weights[p]);
+  }
+  writeValue<uint64_t>(out, nbSites);
+  for (size_t i = 0; i < nbSites; ++i)
+  {
+    writeValue<uint32_t>(out, sitePatterns[i]);
+    writeValue<int32_t>(out, sites.getSite(i).getPosition());
+  }
+  out.close();
+  if (!out)
+  {
+    remove(tmpPath.c_str());
+    throw IOException("AlignmentCache::write. Could not write file " + tmpPath);
+  }
+  if (rename(tmpPath.c_str(), path.c_str()) != 0)
+  {
+    remove(tmpPath.c_str());
+    throw IOException("AlignmentCache::write. Could not replace file " + path);
+  }
+}
+
+/******************************************************************************/
+
+VectorSiteContainer* AlignmentCache::getSitesToAnalyse(
+  const Alphabet* alphabet,
+  map<string, string>& params,
+  const string& suffix,
+  bool suffixIsOptional,
+  bool gapAsUnknown,
+  bool verbose,
+  int warn)
+{
+  string cachePath = ApplicationTools::getAFilePath("input.sequence.cache", params, false, false, suffix, suffixIsOptional, "none", warn);
+  if (cachePath == "none")
+    return SiteFilterTools::getSitesToAnalyse(alphabet, params, suffix, suffixIsOptional, gapAsUnknown, verbose, warn);
+
+  string sequencePath = ApplicationTools::getAFilePath("input.sequence.file", params, true, true, suffix, suffixIsOptional, "none", warn);
+  uint64_t key = getKey(sequencePath, params, gapAsUnknown);
+  if (verbose)
+    ApplicationTools::displayResult("Alignment cache", cachePath);
+  // Only files written by a previous run may be replaced, never another file given by mistake:
+  if (FileTools::fileExists(cachePath) && !isCacheFile(cachePath))
+    throw Exception("The file " + cachePath + " is not an alignment cache, and will not be overwritten. Check the 'input.sequence.cache' option.");
+  VectorSiteContainer* sites = 0;
+  try
+  {
+    sites = read(cachePath, key, alphabet);
+  }
+  catch (Exception& e)
+  {
+    ApplicationTools::displayWarning(string("Alignment cache ignored: ") + e.what());
+  }
+  if (sites)
+  {
+    if (verbose)
+      ApplicationTools::displayResult("Alignment read from cache", "yes");
+    return sites;
+  }
+  if (verbose)
+    ApplicationTools::displayResult("Alignment read from cache", "no (missing or out of date)");
+  sites = SiteFilterTools::getSitesToAnalyse(alphabet, params, suffix, suffixIsOptional, gapAsUnknown, verbose, warn);
+  // The cache is only an optimization, failing to write it does not stop the analysis:
+  try
+  {
+    write(cachePath, key, *sites);
+  }
+  catch (Exception& e)
+  {
+    ApplicationTools::displayWarning(string("Alignment cache not written: ") + e.what());
+  }
+  return sites;
+}
+
+/******************************************************************************/
@@ -0,0 +1,142 @@
+//
+// File: AlignmentCache.h
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BPPSUITE_ALIGNMENTCACHE_H_
+#define _BPPSUITE_ALIGNMENTCACHE_H_
+
+// From the STL:
+#include <cstdint>
+#include <map>
+#include <string>
+
+// From bpp-seq:
+#include <Bpp/Seq/Alphabet/Alphabet.h>
+#include <Bpp/Seq/Container/SiteContainer.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+
+namespace bpp
+{
+/**
+ * @brief On-disk cache of alignments ready to be analysed.
+ *
+ * Reading, filtering and converting gaps of large alignments can take a
+ * significant part of short analyses, which are often run many times on the
+ * same data with different models. The resulting alignment is stored in a
+ * binary file, as the list of sequence names, the distinct site patterns,
+ * their weights, and the pattern and position of each site.
+ *
+ * Cache files are identified by a key, a 64 bits FNV-1a hash of the content
+ * of the sequence file and of all options used to read and filter it.
+ * A cache file with a different key is considered stale and is rebuilt.
+ * Cache files are written in the native byte order, and are meant to be
+ * reused on the machine that created them.
+ */
+class AlignmentCache
+{
+public:
+  /**
+   * @brief Compute the key of an alignment.
+   *
+   * @param path         The path of the sequence file.
+   * @param params       The attribute map where options may be found.
+   * @param gapAsUnknown Tell if gaps are converted to unknown characters.
+   * @return The hash of the file content and of the 'alphabet', 'genetic_code',
+   * 'input.sequence.*' and 'input.site.*' options.
+   */
+  static uint64_t getKey(const std::string& path, const std::map<std::string, std::string>& params, bool gapAsUnknown);
+
+  /**
+   * @param path The path of a file.
+   * @return True if the file starts like a cache file, whatever its version and key.
+   */
+  static bool isCacheFile(const std::string& path);
+
+  /**
+   * @brief Read an alignment from a cache file.
+   *
+   * @param path     The path of the cache file.
+   * @param key      The expected key.
+   * @param alphabet The alphabet of the alignment.
+   * @return A new container, or 0 if the file does not exist, was built with
+   * another key or for another alphabet.
+   * @throw Exception If the file is corrupted.
+   */
+  static VectorSiteContainer* read(const std::string& path, uint64_t key, const Alphabet* alphabet);
+
+  /**
+   * @brief Write an alignment to a cache file.
+   *
+   * The file is written under a temporary name, then renamed, so that an
+   * existing cache is only replaced by a complete one.
+   *
+   * @param path  The path of the cache file.
+   * @param key   The key of the alignment.
+   * @param sites The alignment to store.
+   */
+  static void write(const std::string& path, uint64_t key, const SiteContainer& sites);
+
+  /**
+   * @brief Get the sites to analyse, using a cache file if 'input.sequence.cache' is set.
+   *
+   * If the cache is up to date, the alignment is read from it. Otherwise, it is
+   * read and filtered as in SiteFilterTools::getSitesToAnalyse, and the cache
+   * file is (re)written.
+   *
+   * @param alphabet         The alphabet to use.
+   * @param params           The attribute map where options may be found.
+   * @param suffix           A suffix to be applied to each attribute name.
+   * @param suffixIsOptional Tell if the suffix is absolutely required.
+   * @param gapAsUnknown     Convert gaps to unknown characters (only when all sites are used).
+   * @param verbose          Print some info to the 'message' output stream.
+   * @param warn             Warning level.
+   * @return A new container with the sites to analyse.
+   */
+  static VectorSiteContainer* getSitesToAnalyse(
+    const Alphabet* alphabet,
+    std::map<std::string, std::string>& params,
+    const std::string& suffix = "",
+    bool suffixIsOptional = true,
+    bool gapAsUnknown = true,
+    bool verbose = true,
+    int warn = 1);
+};
+} // end of namespace bpp.
+
+#endif // _BPPSUITE_ALIGNMENTCACHE_H_
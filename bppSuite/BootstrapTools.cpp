@@ -0,0 +1,293 @@
+//
+// File: BootstrapTools.cpp
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "BootstrapTools.h"
+
+// From the STL:
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <memory>
+
+using namespace std;
+
+// From bpp-core:
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Exceptions.h>
+#include <Bpp/Io/FileTools.h>
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+
+// From bpp-phyl:
+#include <Bpp/Phyl/TreeTools.h>
+#include <Bpp/Phyl/App/PhylogeneticsApplicationTools.h>
+#include <Bpp/Phyl/Io/Newick.h>
+
+using namespace bpp;
+
+/******************************************************************************/
+
+unsigned int BootstrapTools::getSeed(map<string, string>& params, int warn)
+{
+  unsigned int seed;
+  if (params.find("bootstrap.seed") != params.end())
+    seed = ApplicationTools::getParameter<unsigned int>("bootstrap.seed", params, 0, "", true, warn);
+  else
+    seed = RandomTools::giveIntRandomNumberBetweenZeroAndEntry<unsigned int>(numeric_limits<unsigned int>::max());
+  return seed;
+}
+
+/******************************************************************************/
+
+mt19937 BootstrapTools::getGenerator(unsigned int seed, size_t replicate)
+{
+  seed_seq seq{ seed, static_cast<unsigned int>(replicate), static_cast<unsigned int>(replicate >> 16 >> 16) };
+  return mt19937(seq);
+}
+
+/******************************************************************************/
+
+VectorSiteContainer* BootstrapTools::bootstrapSites(const SiteContainer& sites, unsigned int seed, size_t replicate)
+{
+  mt19937 generator = getGenerator(seed, replicate);
+  size_t nbSites = sites.getNumberOfSites();
+  uniform_int_distribution<size_t> draw(0, nbSites - 1);
+  VectorSiteContainer* sample = new VectorSiteContainer(sites.getSequencesNames(), sites.getAlphabet());
+  for (size_t i = 0; i < nbSites; ++i)
+  {
+    sample->addSite(sites.getSite(draw(generator)), false);
+  }
+  return sample;
+}
+
+/******************************************************************************/
+
+vector<unsigned int> BootstrapTools::bootstrapWeights(const vector<unsigned int>& weights, unsigned int seed, size_t replicate)
+{
+  mt19937 generator = getGenerator(seed, replicate);
+  unsigned int nbSitesLeft = 0;
+  for (size_t i = 0; i < weights.size(); ++i)
+  {
+    nbSitesLeft += weights[i];
+  }
+  unsigned int totalWeightLeft = nbSitesLeft;
+  vector<unsigned int> sample(weights.size(), 0);
+  // Multinomial draw, as a series of conditional binomial draws:
+  for (size_t i = 0; i < weights.size() && nbSitesLeft > 0; ++i)
+  {
+    if (weights[i] == totalWeightLeft)
+      sample[i] = nbSitesLeft;
+    else if (weights[i] > 0)
+    {
+      binomial_distribution<unsigned int> draw(nbSitesLeft, static_cast<double>(weights[i]) / static_cast<double>(totalWeightLeft));
+      sample[i] = draw(generator);
+    }
+    nbSitesLeft -= sample[i];
+    totalWeightLeft -= weights[i];
+  }
+  return sample;
+}
+
+/******************************************************************************/
+
+VectorSiteContainer* BootstrapTools::getSitesFromPatterns(const SiteContainer& patterns, const vector<unsigned int>& weights)
+{
+  if (weights.size() != patterns.getNumberOfSites())
+    throw Exception("BootstrapTools::getSitesFromPatterns. The number of weights does not match the number of patterns.");
+  VectorSiteContainer* sample = new VectorSiteContainer(patterns.getSequencesNames(), patterns.getAlphabet());
+  for (size_t i = 0; i < weights.size(); ++i)
+  {
+    const Site& site = patterns.getSite(i);
+    for (unsigned int j = 0; j < weights[i]; ++j)
+    {
+      sample->addSite(site, false);
+    }
+  }
+  return sample;
+}
+
+/******************************************************************************/
+
+double BootstrapTools::computeSHLikeSupport(
+  const vector<double>& logL0,
+  const vector<double>& logL1,
+  const vector<double>& logL2,
+  const vector<unsigned int>& weights,
+  unsigned int nbReplicates,
+  unsigned int seed)
+{
+  if (logL0.size() != weights.size() || logL1.size() != weights.size() || logL2.size() != weights.size())
+    throw Exception("BootstrapTools::computeSHLikeSupport. The number of weights does not match the number of patterns.");
+  if (nbReplicates == 0)
+    throw Exception("BootstrapTools::computeSHLikeSupport. At least one replicate is needed.");
+  const vector<double>* logL[3] = { &logL0, &logL1, &logL2 };
+  double total[3] = { 0., 0., 0. };
+  for (size_t k = 0; k < 3; ++k)
+  {
+    for (size_t i = 0; i < weights.size(); ++i)
+    {
+      total[k] += weights[i] * (*logL[k])[i];
+    }
+  }
+  size_t best = total[1] >= total[2] ? 1 : 2;
+  double delta = total[0] - total[best];
+  if (delta <= 0)
+    return 0.;
+
+  unsigned int nbSupporting = 0;
+  for (unsigned int b = 0; b < nbReplicates; ++b)
+  {
+    vector<unsigned int> sample = bootstrapWeights(weights, seed, b);
+    double centered[3];
+    for (size_t k = 0; k < 3; ++k)
+    {
+      centered[k] = -total[k];
+      for (size_t i = 0; i < sample.size(); ++i)
+      {
+        if (sample[i] > 0) centered[k] += sample[i] * (*logL[k])[i];
+      }
+    }
+    double maxCentered = max(centered[0], max(centered[1], centered[2]));
+    if (delta > maxCentered - centered[best])
+      nbSupporting++;
+  }
+  return static_cast<double>(nbSupporting) / static_cast<double>(nbReplicates);
+}
+
+/******************************************************************************/
+
+vector<double> BootstrapTools::getBootstrapValues(const Tree& tree, const vector<Tree*>& bsTrees)
+{
+  unique_ptr<Tree> copy(tree.clone());
+  TreeTools::computeBootstrapValues(*copy, bsTrees, false);
+  vector<int> ids = copy->getNodesId();
+  vector<double> values;
+  for (size_t i = 0; i < ids.size(); ++i)
+  {
+    if (copy->hasBranchProperty(ids[i], TreeTools::BOOTSTRAP))
+      values.push_back(dynamic_cast<const Number<double>*>(copy->getBranchProperty(ids[i], TreeTools::BOOTSTRAP))->getValue());
+  }
+  return values;
+}
+
+/******************************************************************************/
+
+bool BootstrapTools::getShard(map<string, string>& params, size_t nbReplicates, size_t& begin, size_t& end, int warn)
+{
+  begin = 0;
+  end = nbReplicates;
+  string desc = ApplicationTools::getStringParameter("bootstrap.shard", params, "none", "", true, warn);
+  if (desc == "none")
+    return false;
+  string::size_type pos = desc.find('/');
+  if (pos == string::npos)
+    throw Exception("BootstrapTools::getShard. Shard should be of the form 'i/n': " + desc);
+  unsigned int index = TextTools::to<unsigned int>(TextTools::removeSurroundingWhiteSpaces(desc.substr(0, pos)));
+  unsigned int nbShards = TextTools::to<unsigned int>(TextTools::removeSurroundingWhiteSpaces(desc.substr(pos + 1)));
+  if (nbShards == 0 || index == 0 || index > nbShards)
+    throw Exception("BootstrapTools::getShard. Invalid shard: " + desc);
+  if (params.find("bootstrap.seed") == params.end())
+    throw Exception("BootstrapTools::getShard. 'bootstrap.seed' must be set when replicates are sharded.");
+  begin = nbReplicates * (index - 1) / nbShards;
+  end = nbReplicates * index / nbShards;
+  ApplicationTools::displayResult("Bootstrap shard", TextTools::toString(index) + "/" + TextTools::toString(nbShards));
+  ApplicationTools::displayResult("Replicates in shard", TextTools::toString(begin + 1) + "-" + TextTools::toString(end));
+  return true;
+}
+
+/******************************************************************************/
+
+bool BootstrapTools::mergeShards(map<string, string>& params)
+{
+  vector<string> shardPaths = ApplicationTools::getVectorParameter<string>("bootstrap.merge", params, ',', "");
+  if (shardPaths.size() == 0 || (shardPaths.size() == 1 && shardPaths[0] == "none"))
+    return false;
+  ApplicationTools::displayResult("Number of bootstrap shards", shardPaths.size());
+
+  Newick newick;
+  vector<Tree*> bsTrees;
+  for (size_t i = 0; i < shardPaths.size(); ++i)
+  {
+    if (!FileTools::fileExists(shardPaths[i]))
+      throw Exception("BootstrapTools::mergeShards. Shard file not found: " + shardPaths[i]);
+    vector<Tree*> shardTrees;
+    newick.read(shardPaths[i], shardTrees);
+    bsTrees.insert(bsTrees.end(), shardTrees.begin(), shardTrees.end());
+  }
+  ApplicationTools::displayResult("Number of bootstrap trees", bsTrees.size());
+  size_t nbBS = ApplicationTools::getParameter<size_t>("bootstrap.number", params, 0, "", true, 2);
+  if (nbBS > 0 && nbBS != bsTrees.size())
+  {
+    for (size_t i = 0; i < bsTrees.size(); ++i)
+    {
+      delete bsTrees[i];
+    }
+    throw Exception("BootstrapTools::mergeShards. Expected " + TextTools::toString(nbBS) + " trees, found " + TextTools::toString(bsTrees.size()) + ".");
+  }
+
+  // Shard files are copied verbatim, so that the merged file is identical to the one of a single run:
+  string bsTreesPath = ApplicationTools::getAFilePath("bootstrap.output.file", params, false, false);
+  if (bsTreesPath != "none")
+  {
+    ApplicationTools::displayResult("Bootstrap trees stored in file", bsTreesPath);
+    ofstream out(bsTreesPath.c_str(), ios::out);
+    for (size_t i = 0; i < shardPaths.size(); ++i)
+    {
+      ifstream in(shardPaths[i].c_str(), ios::in);
+      if (in.peek() != ifstream::traits_type::eof())
+        out << in.rdbuf();
+    }
+    out.close();
+  }
+
+  unique_ptr<Tree> tree(PhylogeneticsApplicationTools::getTree(params));
+  ApplicationTools::displayTask("Compute bootstrap values");
+  TreeTools::computeBootstrapValues(*tree, bsTrees);
+  ApplicationTools::displayTaskDone();
+  for (size_t i = 0; i < bsTrees.size(); ++i)
+  {
+    delete bsTrees[i];
+  }
+  PhylogeneticsApplicationTools::writeTree(*tree, params);
+  return true;
+}
+
+/******************************************************************************/
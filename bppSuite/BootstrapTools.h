@@ -0,0 +1,198 @@
+//
+// File: BootstrapTools.h
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BPPSUITE_BOOTSTRAPTOOLS_H_
+#define _BPPSUITE_BOOTSTRAPTOOLS_H_
+
+// From the STL:
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// From bpp-seq:
+#include <Bpp/Seq/Container/SiteContainer.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+
+// From bpp-phyl:
+#include <Bpp/Phyl/Tree.h>
+
+namespace bpp
+{
+/**
+ * @brief Tools for reproducible bootstrap analyses.
+ *
+ * Each replicate draws its random numbers from its own generator, seeded
+ * from a base seed and the index of the replicate. A replicate can hence
+ * be computed independently of all others, in any order and by any
+ * thread, and still give the same result.
+ */
+class BootstrapTools
+{
+public:
+  /**
+   * @brief Read the base seed of the bootstrap analysis from the options.
+   *
+   * The 'bootstrap.seed' option is used if present. Otherwise a seed is drawn
+   * from the global random generator, so that the --seed command line argument
+   * also makes bootstrap analyses reproducible.
+   *
+   * @param params The attribute map where options may be found.
+   * @param warn   Warning level.
+   * @return The base seed.
+   */
+  static unsigned int getSeed(std::map<std::string, std::string>& params, int warn = 1);
+
+  /**
+   * @param seed      The base seed of the analysis.
+   * @param replicate The index of the replicate.
+   * @return The random generator dedicated to a replicate.
+   */
+  static std::mt19937 getGenerator(unsigned int seed, size_t replicate);
+
+  /**
+   * @brief Resample sites with replacement, using the generator of a given replicate.
+   *
+   * @param sites     The alignment to resample.
+   * @param seed      The base seed of the analysis.
+   * @param replicate The index of the replicate.
+   * @return A new container with as many sites as the input one.
+   */
+  static VectorSiteContainer* bootstrapSites(const SiteContainer& sites, unsigned int seed, size_t replicate);
+
+  /**
+   * @brief Resample site patterns, using the generator of a given replicate.
+   *
+   * Resampling sites with replacement is equivalent to drawing the number of
+   * occurrences of each distinct pattern from a multinomial distribution,
+   * with probabilities proportional to the pattern weights. The number of
+   * random draws is then proportional to the number of patterns, not sites.
+   *
+   * @param weights   The number of occurrences of each pattern in the original alignment.
+   * @param seed      The base seed of the analysis.
+   * @param replicate The index of the replicate.
+   * @return The number of occurrences of each pattern in the bootstrap sample.
+   */
+  static std::vector<unsigned int> bootstrapWeights(const std::vector<unsigned int>& weights, unsigned int seed, size_t replicate);
+
+  /**
+   * @brief Build an alignment from site patterns and their number of occurrences.
+   *
+   * @param patterns The distinct site patterns.
+   * @param weights  The number of occurrences of each pattern.
+   * @return A new container, where patterns appear in input order, each
+   * repeated as many times as its number of occurrences.
+   */
+  static VectorSiteContainer* getSitesFromPatterns(const SiteContainer& patterns, const std::vector<unsigned int>& weights);
+
+  /**
+   * @brief Compute the SH-like support of a branch.
+   *
+   * The ML tree is compared to the two NNI alternatives around the branch.
+   * Let L0, L1 and L2 be their log-likelihoods, and Lb the best of L1 and L2.
+   * For each replicate, the pattern weights are resampled (RELL), and the
+   * resampled log-likelihoods are centered by subtracting L0, L1 and L2. The
+   * support is the proportion of replicates in which L0 - Lb is larger than the
+   * difference between the largest centered value and the centered value of
+   * the best alternative (Shimodaira-Hasegawa principle).
+   * The support is 0 if the ML tree is not better than its alternatives.
+   *
+   * @param logL0        The log-likelihood of each pattern for the ML tree.
+   * @param logL1        The log-likelihood of each pattern for the first alternative.
+   * @param logL2        The log-likelihood of each pattern for the second alternative.
+   * @param weights      The number of occurrences of each pattern.
+   * @param nbReplicates The number of RELL replicates.
+   * @param seed         The base seed, replicates are drawn as with bootstrapWeights.
+   * @return The support, between 0 and 1.
+   */
+  static double computeSHLikeSupport(
+    const std::vector<double>& logL0,
+    const std::vector<double>& logL1,
+    const std::vector<double>& logL2,
+    const std::vector<unsigned int>& weights,
+    unsigned int nbReplicates,
+    unsigned int seed);
+
+  /**
+   * @brief Compute the bootstrap values of a reference tree, without modifying it.
+   *
+   * @param tree    The reference tree.
+   * @param bsTrees The bootstrap trees.
+   * @return The bootstrap value of each branch of the reference tree carrying one,
+   * in the order of the node ids. Values are comparable between calls on the same tree.
+   */
+  static std::vector<double> getBootstrapValues(const Tree& tree, const std::vector<Tree*>& bsTrees);
+
+  /**
+   * @brief Read the slice of replicates to compute from the 'bootstrap.shard' option.
+   *
+   * The option has the form 'i/n', with 1 <= i <= n. Replicates are split into
+   * n contiguous slices, and shard i computes replicates [begin, end) of slice i.
+   * As replicates have their own generators, concatenating the outputs of all
+   * shards in shard order gives exactly the output of a single run. The base
+   * seed must then be the same for all shards, hence 'bootstrap.seed' is
+   * required.
+   *
+   * @param params       The attribute map where options may be found.
+   * @param nbReplicates The total number of replicates.
+   * @param begin        [out] The index of the first replicate of the shard.
+   * @param end          [out] The index after the last replicate of the shard.
+   * @param warn         Warning level.
+   * @return True if the analysis is sharded. Otherwise, [begin, end) covers all replicates.
+   */
+  static bool getShard(std::map<std::string, std::string>& params, size_t nbReplicates, size_t& begin, size_t& end, int warn = 1);
+
+  /**
+   * @brief Merge the trees of several shards, as listed in the 'bootstrap.merge' option.
+   *
+   * Shard files are concatenated, in the order they are listed, into
+   * 'bootstrap.output.file' (if set). Bootstrap values are then computed on
+   * the reference tree read from 'input.tree.file', and the resulting tree is
+   * written to 'output.tree.file'. If 'bootstrap.number' is set, it must
+   * match the total number of trees found.
+   *
+   * @param params The attribute map where options may be found.
+   * @return True if the merge was requested and done, false if 'bootstrap.merge' is not set.
+   */
+  static bool mergeShards(std::map<std::string, std::string>& params);
+};
+} // end of namespace bpp.
+
+#endif // _BPPSUITE_BOOTSTRAPTOOLS_H_
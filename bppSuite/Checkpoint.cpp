@@ -0,0 +1,213 @@
+//
+// File: Checkpoint.cpp
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "Checkpoint.h"
+
+// From the STL:
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+using namespace std;
+
+// From bpp-core:
+#include <Bpp/Exceptions.h>
+#include <Bpp/Io/FileTools.h>
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/Text/TextTools.h>
+
+// From bpp-phyl:
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/TreeTools.h>
+
+using namespace bpp;
+
+/******************************************************************************/
+
+Checkpoint::Checkpoint(const string& path, double interval) :
+  path_(path),
+  interval_(interval),
+  lastSave_(chrono::steady_clock::now()),
+  values_()
+{}
+
+/******************************************************************************/
+
+bool Checkpoint::restore()
+{
+  if (!FileTools::fileExists(path_))
+    return false;
+  ifstream in(path_.c_str(), ios::in);
+  string line;
+  while (getline(in, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+    string::size_type pos = line.find(" = ");
+    if (pos == string::npos)
+      throw Exception("Checkpoint::restore. Invalid line in file " + path_ + ": " + line);
+    values_[line.substr(0, pos)] = line.substr(pos + 3);
+  }
+  return true;
+}
+
+/******************************************************************************/
+
+void Checkpoint::save()
+{
+  string tmpPath = path_ + ".tmp";
+  ofstream out(tmpPath.c_str(), ios::out);
+  out << "# BppSuite checkpoint file, do not edit." << endl;
+  for (map<string, string>::const_iterator it = values_.begin(); it != values_.end(); ++it)
+  {
+    out << it->first << " = " << it->second << endl;
+  }
+  out.close();
+  if (!out)
+    throw Exception("Checkpoint::save. Could not write file " + tmpPath);
+  if (rename(tmpPath.c_str(), path_.c_str()) != 0)
+    throw Exception("Checkpoint::save. Could not replace file " + path_);
+  lastSave_ = chrono::steady_clock::now();
+}
+
+/******************************************************************************/
+
+void Checkpoint::saveIfDue()
+{
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - lastSave_;
+  if (elapsed.count() >= interval_)
+    save();
+}
+
+/******************************************************************************/
+
+string Checkpoint::getValue(const string& key) const
+{
+  map<string, string>::const_iterator it = values_.find(key);
+  return it == values_.end() ? "" : it->second;
+}
+
+/******************************************************************************/
+
+void Checkpoint::setParameters(const string& key, const ParameterList& parameters)
+{
+  // Remove previous values, in case the parameter list changed:
+  string prefix = key + ".";
+  map<string, string>::iterator it = values_.lower_bound(prefix);
+  while (it != values_.end() && it->first.compare(0, prefix.size(), prefix) == 0)
+  {
+    values_.erase(it++);
+  }
+  for (size_t i = 0; i < parameters.size(); ++i)
+  {
+    ostringstream value;
+    value << setprecision(numeric_limits<double>::max_digits10) << parameters[i].getValue();
+    values_[prefix + parameters[i].getName()] = value.str();
+  }
+}
+
+/******************************************************************************/
+
+ParameterList Checkpoint::getParameters(const string& key) const
+{
+  ParameterList parameters;
+  string prefix = key + ".";
+  for (map<string, string>::const_iterator it = values_.lower_bound(prefix);
+       it != values_.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+  {
+    parameters.addParameter(Parameter(it->first.substr(prefix.size()), TextTools::toDouble(it->second)));
+  }
+  return parameters;
+}
+
+/******************************************************************************/
+
+namespace
+{
+/**
+ * @brief Write a subtree in Newick format, with branch lengths at full precision.
+ *
+ * TreeTemplateTools::treeToParenthesis uses the default stream precision,
+ * which would change the trees of a resumed analysis.
+ */
+void writeNode(const Node& node, ostream& out)
+{
+  if (node.isLeaf())
+    out << node.getName();
+  else
+  {
+    out << "(";
+    for (size_t i = 0; i < node.getNumberOfSons(); ++i)
+    {
+      if (i > 0) out << ",";
+      writeNode(*node.getSon(i), out);
+    }
+    out << ")";
+    if (node.hasBranchProperty(TreeTools::BOOTSTRAP))
+      out << dynamic_cast<const Number<double>*>(node.getBranchProperty(TreeTools::BOOTSTRAP))->getValue();
+  }
+  if (node.hasDistanceToFather())
+    out << ":" << node.getDistanceToFather();
+}
+}
+
+void Checkpoint::setTree(const string& key, const Tree& tree)
+{
+  TreeTemplate<Node> ttree(tree);
+  ostringstream description;
+  description << setprecision(numeric_limits<double>::max_digits10);
+  writeNode(*ttree.getRootNode(), description);
+  description << ";";
+  values_[key] = description.str();
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* Checkpoint::getTree(const string& key) const
+{
+  if (!hasValue(key))
+    throw Exception("Checkpoint::getTree. No tree stored for " + key + " in file " + path_);
+  return TreeTemplateTools::parenthesisToTree(getValue(key), true, TreeTools::BOOTSTRAP, false, false);
+}
+
+/******************************************************************************/
+
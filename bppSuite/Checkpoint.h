@@ -0,0 +1,127 @@
+//
+// File: Checkpoint.h
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BPPSUITE_CHECKPOINT_H_
+#define _BPPSUITE_CHECKPOINT_H_
+
+// From the STL:
+#include <chrono>
+#include <map>
+#include <string>
+
+// From bpp-core:
+#include <Bpp/Numeric/ParameterList.h>
+
+// From bpp-phyl:
+#include <Bpp/Phyl/Tree.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+
+namespace bpp
+{
+/**
+ * @brief Save and restore the state of a long analysis.
+ *
+ * The state is a set of key/value pairs, written as a plain text file
+ * with one 'key = value' entry per line. Parameter lists and trees are
+ * stored under a key prefix, and can be retrieved from it.
+ * The file is first written to a temporary file which then replaces the
+ * previous checkpoint, so that an interrupted write never loses it.
+ */
+class Checkpoint
+{
+private:
+  std::string path_;
+  double interval_;
+  std::chrono::steady_clock::time_point lastSave_;
+  std::map<std::string, std::string> values_;
+
+public:
+  /**
+   * @param path     The checkpoint file.
+   * @param interval Minimum time, in seconds, between two periodic saves.
+   */
+  Checkpoint(const std::string& path, double interval);
+
+public:
+  /**
+   * @brief Load the checkpoint file, if it exists.
+   *
+   * @return True if a previous state was found.
+   */
+  bool restore();
+
+  /**
+   * @brief Write the current state to file.
+   */
+  void save();
+
+  /**
+   * @brief Write the current state to file if the last save is older than the interval.
+   */
+  void saveIfDue();
+
+  const std::string& getPath() const { return path_; }
+
+  bool hasValue(const std::string& key) const { return values_.find(key) != values_.end(); }
+
+  /**
+   * @return The value stored for the key, or an empty string if none.
+   */
+  std::string getValue(const std::string& key) const;
+
+  void setValue(const std::string& key, const std::string& value) { values_[key] = value; }
+
+  void setParameters(const std::string& key, const ParameterList& parameters);
+
+  /**
+   * @return All parameters stored under the key, without constraints.
+   */
+  ParameterList getParameters(const std::string& key) const;
+
+  void setTree(const std::string& key, const Tree& tree);
+
+  /**
+   * @return A new tree, parsed from the description stored for the key.
+   */
+  TreeTemplate<Node>* getTree(const std::string& key) const;
+};
+} // end of namespace bpp.
+
+#endif // _BPPSUITE_CHECKPOINT_H_
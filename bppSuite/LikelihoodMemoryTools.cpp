@@ -0,0 +1,166 @@
+//
+// File: LikelihoodMemoryTools.cpp
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "LikelihoodMemoryTools.h"
+
+// From the STL:
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// From bpp-core:
+#include <Bpp/Exceptions.h>
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Text/TextTools.h>
+
+// From bpp-phyl:
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/PatternTools.h>
+
+using namespace bpp;
+
+/******************************************************************************/
+
+namespace
+{
+const double DOUBLE_SIZE = static_cast<double>(sizeof(double));
+
+// Size of the transition probabilities and their two derivatives, for all branches:
+double getTransitionMatricesMemory(size_t nbNodes, size_t nbClasses, size_t nbStates)
+{
+  return 3. * static_cast<double>(nbNodes * nbClasses * nbStates * nbStates) * DOUBLE_SIZE;
+}
+
+// Add the size of the arrays of the subtree below a node, and return its number of leaves:
+size_t addSimpleRecursionMemory(const Node& node, double nbPatterns, double arraySize, size_t nbStates, bool recursiveCompression, double& memory)
+{
+  size_t nbLeaves = 0;
+  for (size_t i = 0; i < node.getNumberOfSons(); ++i)
+  {
+    nbLeaves += addSimpleRecursionMemory(*node.getSon(i), nbPatterns, arraySize, nbStates, recursiveCompression, memory);
+  }
+  if (node.isLeaf())
+    nbLeaves = 1;
+  // Each leaf may also be a gap or unknown character:
+  double nbSubPatterns = recursiveCompression ?
+    min(nbPatterns, pow(static_cast<double>(nbStates + 1), static_cast<double>(nbLeaves))) :
+    nbPatterns;
+  memory += 3. * nbSubPatterns * arraySize;
+  return nbLeaves;
+}
+}
+
+/******************************************************************************/
+
+double LikelihoodMemoryTools::estimateDoubleRecursionMemory(const Tree& tree, size_t nbPatterns, size_t nbClasses, size_t nbStates)
+{
+  size_t nbNodes = tree.getNumberOfNodes();
+  size_t nbLeaves = tree.getNumberOfLeaves();
+  double arraySize = static_cast<double>(nbPatterns * nbClasses * nbStates) * DOUBLE_SIZE;
+  // One array per direction of each branch, plus the ones at the root:
+  double memory = static_cast<double>(2 * (nbNodes - 1) + 1) * arraySize;
+  // Leaf likelihoods do not depend on the rate class:
+  memory += static_cast<double>(nbLeaves * nbPatterns * nbStates) * DOUBLE_SIZE;
+  return memory + getTransitionMatricesMemory(nbNodes, nbClasses, nbStates);
+}
+
+/******************************************************************************/
+
+double LikelihoodMemoryTools::estimateSimpleRecursionMemory(const Tree& tree, size_t nbPatterns, size_t nbClasses, size_t nbStates, bool recursiveCompression)
+{
+  TreeTemplate<Node> ttree(tree);
+  double arraySize = static_cast<double>(nbClasses * nbStates) * DOUBLE_SIZE;
+  double memory = 0;
+  addSimpleRecursionMemory(*ttree.getRootNode(), static_cast<double>(nbPatterns), arraySize, nbStates, recursiveCompression, memory);
+  return memory + getTransitionMatricesMemory(ttree.getNumberOfNodes(), nbClasses, nbStates);
+}
+
+/******************************************************************************/
+
+double LikelihoodMemoryTools::getMemoryLimit(map<string, string>& params)
+{
+  double defaultLimit = 0;
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+  long nbPages = sysconf(_SC_PHYS_PAGES);
+  long pageSize = sysconf(_SC_PAGESIZE);
+  if (nbPages > 0 && pageSize > 0)
+    defaultLimit = static_cast<double>(nbPages) * static_cast<double>(pageSize) / 1048576.;
+#endif
+  double limit = ApplicationTools::getDoubleParameter("likelihood.memory_limit", params, defaultLimit, "", true, 2);
+  if (limit < 0)
+    throw Exception("LikelihoodMemoryTools::getMemoryLimit. The memory limit should be positive.");
+  return limit * 1048576.;
+}
+
+/******************************************************************************/
+
+string LikelihoodMemoryTools::chooseRecursion(
+  const Tree& tree,
+  const SiteContainer& sites,
+  size_t nbClasses,
+  size_t nbStates,
+  map<string, string>& params)
+{
+  unique_ptr<SiteContainer> patterns(PatternTools::shrinkSiteSet(sites));
+  size_t nbPatterns = patterns->getNumberOfSites();
+  patterns.reset();
+  double limit = getMemoryLimit(params);
+  // The simple recursion is built with the compression requested by the user:
+  string compression = ApplicationTools::getStringParameter("likelihood.recursion_simple.compression", params, "recursive", "", true, 2);
+  double doubleMemory = estimateDoubleRecursionMemory(tree, nbPatterns, nbClasses, nbStates);
+  double simpleMemory = estimateSimpleRecursionMemory(tree, nbPatterns, nbClasses, nbStates, compression != "simple");
+  ApplicationTools::displayResult("Number of distinct site patterns", nbPatterns);
+  ApplicationTools::displayResult("Memory limit (MB)", limit > 0 ? TextTools::toString(limit / 1048576., 6) : "none");
+  ApplicationTools::displayResult("Estimated memory, double recursion (MB)", TextTools::toString(doubleMemory / 1048576., 6));
+  ApplicationTools::displayResult("Estimated memory, simple recursion (MB)", TextTools::toString(simpleMemory / 1048576., 6));
+  if (limit == 0 || doubleMemory <= limit)
+    return "double";
+  if (simpleMemory > limit)
+    ApplicationTools::displayWarning("The estimated memory usage exceeds likelihood.memory_limit, even with the simple recursion.");
+  return "simple";
+}
+
+/******************************************************************************/
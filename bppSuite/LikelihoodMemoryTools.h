@@ -0,0 +1,136 @@
+//
+// File: LikelihoodMemoryTools.h
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BPPSUITE_LIKELIHOODMEMORYTOOLS_H_
+#define _BPPSUITE_LIKELIHOODMEMORYTOOLS_H_
+
+// From the STL:
+#include <map>
+#include <string>
+
+// From bpp-seq:
+#include <Bpp/Seq/Container/SiteContainer.h>
+
+// From bpp-phyl:
+#include <Bpp/Phyl/Tree.h>
+
+namespace bpp
+{
+/**
+ * @brief Estimate the memory used by likelihood objects, and choose a recursion accordingly.
+ *
+ * Estimates count the conditional likelihood arrays and transition
+ * matrices, which dominate memory usage for all but the smallest data sets.
+ */
+class LikelihoodMemoryTools
+{
+public:
+  /**
+   * @brief Estimate the memory needed by the double recursion.
+   *
+   * Conditional likelihoods are stored in both directions of each branch,
+   * for all distinct site patterns.
+   *
+   * @param tree       The tree.
+   * @param nbPatterns The number of distinct site patterns.
+   * @param nbClasses  The number of rate classes (times the number of models, for mixtures).
+   * @param nbStates   The number of states of the model.
+   * @return The estimated size, in bytes.
+   */
+  static double estimateDoubleRecursionMemory(const Tree& tree, size_t nbPatterns, size_t nbClasses, size_t nbStates);
+
+  /**
+   * @brief Estimate the memory needed by the simple recursion.
+   *
+   * Conditional likelihoods and their two derivatives are stored at each
+   * node. With recursive compression, they are stored for the distinct
+   * patterns of the subtree below the node, a number bounded by the number
+   * of distinct site patterns, and by the number of possible state
+   * combinations for the leaves of the subtree. Otherwise, they are stored
+   * for all distinct site patterns.
+   *
+   * @param tree                 The tree.
+   * @param nbPatterns           The number of distinct site patterns.
+   * @param nbClasses            The number of rate classes (times the number of models, for mixtures).
+   * @param nbStates             The number of states of the model.
+   * @param recursiveCompression Whether recursive compression is used.
+   * @return The estimated size, in bytes.
+   */
+  static double estimateSimpleRecursionMemory(const Tree& tree, size_t nbPatterns, size_t nbClasses, size_t nbStates, bool recursiveCompression = true);
+
+  /**
+   * @brief Get the memory budget for likelihood computations.
+   *
+   * The budget is read from the 'likelihood.memory_limit' option, in megabytes.
+   * By default, the physical memory of the computer is used when it is
+   * known, and no limit is set otherwise.
+   *
+   * @param params The attribute map where options may be found.
+   * @return The budget, in bytes, or 0 if there is no limit.
+   */
+  static double getMemoryLimit(std::map<std::string, std::string>& params);
+
+  /**
+   * @brief Choose the fastest recursion whose estimated memory fits the budget.
+   *
+   * The double recursion is preferred, as it provides faster derivatives for
+   * the optimization of branch lengths. The simple recursion is chosen
+   * otherwise, with a warning if it does not fit the budget either. Its
+   * estimate uses the compression read from the
+   * 'likelihood.recursion_simple.compression' option.
+   * Estimates and the choice made are written to the standard output.
+   *
+   * @param tree      The tree.
+   * @param sites     The alignment.
+   * @param nbClasses The number of rate classes (times the number of models, for mixtures).
+   * @param nbStates  The number of states of the model.
+   * @param params    The attribute map where options may be found.
+   * @return Either "double" or "simple".
+   */
+  static std::string chooseRecursion(
+    const Tree& tree,
+    const SiteContainer& sites,
+    size_t nbClasses,
+    size_t nbStates,
+    std::map<std::string, std::string>& params);
+};
+} // end of namespace bpp.
+
+#endif // _BPPSUITE_LIKELIHOODMEMORYTOOLS_H_
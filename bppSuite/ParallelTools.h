@@ -0,0 +1,145 @@
+//
+// File: ParallelTools.h
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BPPSUITE_PARALLELTOOLS_H_
+#define _BPPSUITE_PARALLELTOOLS_H_
+
+// From the STL:
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <map>
+
+// From bpp-core:
+#include <Bpp/App/ApplicationTools.h>
+
+namespace bpp
+{
+/**
+ * @brief Minimal helpers for running independent tasks on several threads.
+ *
+ * Tasks are distributed dynamically: each worker picks the next
+ * unprocessed index until all have been done. Results should therefore
+ * never depend on which worker ran a given task.
+ */
+class ParallelTools
+{
+public:
+  /**
+   * @brief Read a number of threads from the options.
+   *
+   * A value of 0 means 'use all available cores'.
+   *
+   * @param name   The name of the option.
+   * @param params The attribute map where options may be found.
+   * @param warn   Warning level.
+   * @return The number of threads to use, at least 1.
+   */
+  static unsigned int getNumberOfThreads(const std::string& name, std::map<std::string, std::string>& params, int warn = 1)
+  {
+    unsigned int nbThreads = ApplicationTools::getParameter<unsigned int>(name, params, 1, "", true, warn);
+    if (nbThreads == 0)
+      nbThreads = std::thread::hardware_concurrency();
+    if (nbThreads == 0)
+      nbThreads = 1;
+    return nbThreads;
+  }
+
+  /**
+   * @brief Call f(i, w) for all i in [0, n), where w is the index of the worker running the task.
+   *
+   * The worker index allows the caller to provide per-thread copies of
+   * objects that cannot be shared (models, likelihood objects, etc.).
+   * If any task throws an exception, remaining tasks are skipped and the
+   * first exception is rethrown in the calling thread.
+   *
+   * @param n         The number of tasks.
+   * @param nbThreads The number of workers to use.
+   * @param f         The task function.
+   */
+  template<class Function>
+  static void parallelFor(size_t n, unsigned int nbThreads, Function f)
+  {
+    if (nbThreads <= 1 || n <= 1)
+    {
+      for (size_t i = 0; i < n; ++i)
+        f(i, 0);
+      return;
+    }
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto worker = [&](unsigned int w) {
+      while (!failed)
+      {
+        size_t i = next++;
+        if (i >= n) return;
+        try
+        {
+          f(i, w);
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> lock(errorMutex);
+          if (!failed)
+          {
+            error = std::current_exception();
+            failed = true;
+          }
+        }
+      }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned int w = 1; w < nbThreads; ++w)
+      threads.push_back(std::thread(worker, w));
+    worker(0);
+    for (size_t w = 0; w < threads.size(); ++w)
+      threads[w].join();
+    if (error)
+      std::rethrow_exception(error);
+  }
+};
+} // end of namespace bpp.
+
+#endif // _BPPSUITE_PARALLELTOOLS_H_
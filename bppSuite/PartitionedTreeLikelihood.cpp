@@ -0,0 +1,389 @@
+//
+// File: PartitionedTreeLikelihood.cpp
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "PartitionedTreeLikelihood.h"
+#include "ParallelTools.h"
+#include "PerformanceMonitor.h"
+
+// From the STL:
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+
+using namespace std;
+
+// From bpp-core:
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Exceptions.h>
+#include <Bpp/Numeric/Constraints.h>
+#include <Bpp/Text/StringTokenizer.h>
+#include <Bpp/Text/TextTools.h>
+
+// From bpp-seq:
+#include <Bpp/Seq/Container/SiteContainerTools.h>
+
+// From bpp-phyl:
+#include <Bpp/Phyl/OptimizationTools.h>
+
+using namespace bpp;
+
+namespace
+{
+/**
+ * @brief Bring a value within the constraint of a parameter.
+ */
+double getAcceptedValue(const Parameter& parameter, double value)
+{
+  const Constraint* constraint = parameter.getConstraint();
+  if (constraint && !constraint->isCorrect(value))
+    return constraint->getAcceptedLimit(value);
+  return value;
+}
+}
+
+/******************************************************************************/
+
+PartitionedTreeLikelihood::PartitionedTreeLikelihood(
+  const Tree& tree,
+  const SiteContainer& sites,
+  const vector<Partition>& partitions,
+  const vector<TransitionModel*>& models,
+  const vector<DiscreteDistribution*>& rDists,
+  bool proportional,
+  unsigned int nbThreads) :
+  partitions_(partitions),
+  models_(models),
+  rDists_(rDists),
+  likelihoods_(partitions.size(), 0),
+  rates_(partitions.size(), 1.),
+  brLens_(),
+  proportional_(proportional),
+  nbThreads_(nbThreads)
+{
+  if (partitions_.size() == 0)
+    throw Exception("PartitionedTreeLikelihood. At least one partition is needed.");
+  if (models_.size() != partitions_.size() || rDists_.size() != partitions_.size())
+    throw Exception("PartitionedTreeLikelihood. There should be one model and one rate distribution per partition.");
+  TreeTemplate<Node> unrootedTree(tree);
+  if (unrootedTree.isRooted())
+    unrootedTree.unroot();
+  ParallelTools::parallelFor(partitions_.size(), nbThreads_, [&](size_t i, unsigned int) {
+    unique_ptr<SiteContainer> partitionSites(SiteContainerTools::getSelectedSites(sites, partitions_[i].sites));
+    if (models_[i]->getName() != "RE08")
+      SiteContainerTools::changeGapsToUnknownCharacters(*partitionSites);
+    likelihoods_[i] = new CountingTreeLikelihood<DRHomogeneousTreeLikelihood>(unrootedTree, *partitionSites, models_[i], rDists_[i], true, false);
+    likelihoods_[i]->initialize();
+  });
+  brLens_ = likelihoods_[0]->getBranchLengthsParameters();
+}
+
+/******************************************************************************/
+
+PartitionedTreeLikelihood::~PartitionedTreeLikelihood()
+{
+  for (size_t i = 0; i < partitions_.size(); ++i)
+  {
+    delete likelihoods_[i];
+    delete models_[i];
+    delete rDists_[i];
+  }
+}
+
+/******************************************************************************/
+
+vector<Partition> PartitionedTreeLikelihood::readPartitions(const string& path, const SiteContainer& sites)
+{
+  ifstream in(path.c_str(), ios::in);
+  if (!in)
+    throw IOException("PartitionedTreeLikelihood::readPartitions. Cannot read file " + path);
+
+  // Sites are found from their position in the original alignment:
+  map<int, size_t> siteIndices;
+  for (size_t i = 0; i < sites.getNumberOfSites(); ++i)
+  {
+    siteIndices[sites.getSite(i).getPosition()] = i;
+  }
+  vector<bool> assigned(sites.getNumberOfSites(), false);
+  set<string> names;
+
+  vector<Partition> partitions;
+  string line;
+  while (getline(in, line))
+  {
+    line = TextTools::removeSurroundingWhiteSpaces(line);
+    if (line.size() == 0 || line[0] == '#')
+      continue;
+    string::size_type equalPos = line.find('=');
+    if (equalPos == string::npos)
+      throw Exception("PartitionedTreeLikelihood::readPartitions. Missing '=' in line: " + line);
+    Partition partition;
+    partition.name = line.substr(0, equalPos);
+    string::size_type comma = partition.name.rfind(',');
+    if (comma != string::npos)
+      partition.name = partition.name.substr(comma + 1);
+    partition.name = TextTools::removeSurroundingWhiteSpaces(partition.name);
+    if (partition.name.size() == 0)
+      throw Exception("PartitionedTreeLikelihood::readPartitions. Missing partition name in line: " + line);
+    if (!names.insert(partition.name).second)
+      throw Exception("PartitionedTreeLikelihood::readPartitions. Duplicated partition name: " + partition.name);
+
+    StringTokenizer st(line.substr(equalPos + 1), ",");
+    while (st.hasMoreToken())
+    {
+      string range = TextTools::removeSurroundingWhiteSpaces(st.nextToken());
+      int step = 1;
+      string::size_type backslash = range.find('\\');
+      if (backslash != string::npos)
+      {
+        step = TextTools::to<int>(TextTools::removeSurroundingWhiteSpaces(range.substr(backslash + 1)));
+        range = range.substr(0, backslash);
+      }
+      int first, last;
+      string::size_type dash = range.find('-');
+      if (dash != string::npos)
+      {
+        first = TextTools::to<int>(TextTools::removeSurroundingWhiteSpaces(range.substr(0, dash)));
+        last = TextTools::to<int>(TextTools::removeSurroundingWhiteSpaces(range.substr(dash + 1)));
+      }
+      else
+        first = last = TextTools::to<int>(range);
+      if (first < 1 || last < first || step < 1)
+        throw Exception("PartitionedTreeLikelihood::readPartitions. Invalid range in partition " + partition.name + ": " + range);
+      for (int position = first; position <= last; position += step)
+      {
+        map<int, size_t>::const_iterator it = siteIndices.find(position);
+        if (it == siteIndices.end())
+          continue; // The site was filtered out.
+        if (assigned[it->second])
+          throw Exception("PartitionedTreeLikelihood::readPartitions. Site " + TextTools::toString(position) + " belongs to several partitions.");
+        assigned[it->second] = true;
+        partition.sites.push_back(it->second);
+      }
+    }
+    sort(partition.sites.begin(), partition.sites.end());
+    if (partition.sites.size() == 0)
+      ApplicationTools::displayWarning("Partition '" + partition.name + "' has no site to analyse, it is ignored.");
+    else
+      partitions.push_back(partition);
+  }
+  size_t nbUnassigned = static_cast<size_t>(count(assigned.begin(), assigned.end(), false));
+  if (nbUnassigned > 0)
+    ApplicationTools::displayWarning(TextTools::toString(nbUnassigned) + " sites do not belong to any partition, they are ignored.");
+  return partitions;
+}
+
+/******************************************************************************/
+
+double PartitionedTreeLikelihood::getLogLikelihood() const
+{
+  double logL = 0;
+  for (size_t i = 0; i < likelihoods_.size(); ++i)
+  {
+    logL += getLogLikelihood(i);
+  }
+  return logL;
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* PartitionedTreeLikelihood::getTree() const
+{
+  // The rate of the first partition is always 1:
+  return new TreeTemplate<Node>(likelihoods_[0]->getTree());
+}
+
+/******************************************************************************/
+
+void PartitionedTreeLikelihood::setBranchLengths_(size_t i, double rate)
+{
+  ParameterList brLens = brLens_;
+  for (size_t j = 0; j < brLens.size(); ++j)
+  {
+    brLens[j].setValue(getAcceptedValue(brLens[j], rate * brLens_[j].getValue()));
+  }
+  likelihoods_[i]->matchParametersValues(brLens);
+}
+
+/******************************************************************************/
+
+unsigned int PartitionedTreeLikelihood::optimize(double tolerance, unsigned int maxRounds, bool verbose)
+{
+  double logL = getLogLikelihood();
+  unsigned int round = 0;
+  while (round < maxRounds)
+  {
+    round++;
+    optimizeModelParameters_(tolerance);
+    optimizeRates_(tolerance);
+    optimizeBranchLengths_(tolerance);
+    double newLogL = getLogLikelihood();
+    if (verbose)
+      ApplicationTools::displayResult("Log likelihood after round " + TextTools::toString(round), TextTools::toString(newLogL, 15));
+    bool converged = (newLogL - logL < tolerance);
+    logL = newLogL;
+    if (converged)
+      break;
+  }
+  return round;
+}
+
+/******************************************************************************/
+
+void PartitionedTreeLikelihood::optimizeModelParameters_(double tolerance)
+{
+  ParallelTools::parallelFor(partitions_.size(), nbThreads_, [&](size_t i, unsigned int) {
+    ParameterList parameters = likelihoods_[i]->getSubstitutionModelParameters();
+    parameters.addParameters(likelihoods_[i]->getRateDistributionParameters());
+    if (parameters.size() > 0)
+      OptimizationTools::optimizeNumericalParameters(likelihoods_[i], parameters, 0, 1, tolerance, 1000000, 0, 0, false, 0);
+  });
+}
+
+/******************************************************************************/
+
+void PartitionedTreeLikelihood::optimizeRates_(double tolerance)
+{
+  if (!proportional_)
+    return;
+  // Golden section search on the logarithm of the rate, within a factor 10 of the current rate:
+  const double ratio = (sqrt(5.) - 1.) / 2.;
+  const double precision = max(tolerance, 1e-4);
+  ParallelTools::parallelFor(partitions_.size(), nbThreads_, [&](size_t i, unsigned int) {
+    if (i == 0) return;
+    auto value = [&](double x) {
+      setBranchLengths_(i, exp(x));
+      return likelihoods_[i]->getValue();
+    };
+    double x0 = log(rates_[i]);
+    double f0 = likelihoods_[i]->getValue();
+    double a = x0 - log(10.), b = x0 + log(10.);
+    double c = b - ratio * (b - a), d = a + ratio * (b - a);
+    double fc = value(c), fd = value(d);
+    while (b - a > precision)
+    {
+      if (fc < fd)
+      {
+        b = d; d = c; fd = fc;
+        c = b - ratio * (b - a);
+        fc = value(c);
+      }
+      else
+      {
+        a = c; c = d; fc = fd;
+        d = a + ratio * (b - a);
+        fd = value(d);
+      }
+    }
+    double x = (a + b) / 2.;
+    if (value(x) < f0)
+      rates_[i] = exp(x);
+    setBranchLengths_(i, rates_[i]);
+  });
+}
+
+/******************************************************************************/
+
+void PartitionedTreeLikelihood::optimizeBranchLengths_(double tolerance)
+{
+  size_t nbPartitions = partitions_.size();
+  size_t nbBranches = brLens_.size();
+  double value = -getLogLikelihood();
+  for (unsigned int iteration = 0; iteration < 100; ++iteration)
+  {
+    // Derivatives of the shared branch lengths are sums over all partitions:
+    vector< vector<double> > d1(nbPartitions, vector<double>(nbBranches));
+    vector< vector<double> > d2(nbPartitions, vector<double>(nbBranches));
+    ParallelTools::parallelFor(nbPartitions, nbThreads_, [&](size_t i, unsigned int) {
+      for (size_t j = 0; j < nbBranches; ++j)
+      {
+        d1[i][j] = likelihoods_[i]->getFirstOrderDerivative(brLens_[j].getName());
+        d2[i][j] = likelihoods_[i]->getSecondOrderDerivative(brLens_[j].getName());
+      }
+    });
+    vector<double> movements(nbBranches, 0.);
+    for (size_t j = 0; j < nbBranches; ++j)
+    {
+      double firstOrderDerivative = 0, secondOrderDerivative = 0;
+      for (size_t i = 0; i < nbPartitions; ++i)
+      {
+        firstOrderDerivative += rates_[i] * d1[i][j];
+        secondOrderDerivative += rates_[i] * rates_[i] * d2[i][j];
+      }
+      // As in PseudoNewtonOptimizer, branches with a negative curvature are not moved:
+      if (secondOrderDerivative > 0)
+        movements[j] = firstOrderDerivative / secondOrderDerivative;
+    }
+
+    // Back-track until the likelihood improves:
+    ParameterList previous = brLens_;
+    double newValue = value;
+    bool improved = false;
+    for (unsigned int k = 0; k < 10 && !improved; ++k)
+    {
+      for (size_t j = 0; j < nbBranches; ++j)
+      {
+        brLens_[j].setValue(getAcceptedValue(brLens_[j], previous[j].getValue() - movements[j]));
+        movements[j] /= 2.;
+      }
+      ParallelTools::parallelFor(nbPartitions, nbThreads_, [&](size_t i, unsigned int) {
+        setBranchLengths_(i, rates_[i]);
+      });
+      newValue = -getLogLikelihood();
+      improved = (newValue <= value);
+    }
+    if (!improved)
+    {
+      brLens_ = previous;
+      ParallelTools::parallelFor(nbPartitions, nbThreads_, [&](size_t i, unsigned int) {
+        setBranchLengths_(i, rates_[i]);
+      });
+      return;
+    }
+    bool converged = (value - newValue < tolerance);
+    value = newValue;
+    if (converged)
+      return;
+  }
+}
+
+/******************************************************************************/
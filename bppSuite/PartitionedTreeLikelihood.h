@@ -0,0 +1,200 @@
+//
+// File: PartitionedTreeLikelihood.h
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BPPSUITE_PARTITIONEDTREELIKELIHOOD_H_
+#define _BPPSUITE_PARTITIONEDTREELIKELIHOOD_H_
+
+// From the STL:
+#include <string>
+#include <vector>
+
+// From bpp-core:
+#include <Bpp/Numeric/ParameterList.h>
+#include <Bpp/Numeric/Prob/DiscreteDistribution.h>
+
+// From bpp-seq:
+#include <Bpp/Seq/Container/SiteContainer.h>
+
+// From bpp-phyl:
+#include <Bpp/Phyl/Tree.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/Model/SubstitutionModel.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+
+namespace bpp
+{
+/**
+ * @brief A set of sites analysed with their own model, e.g. a gene or a codon position.
+ */
+struct Partition
+{
+  std::string name;
+
+  /**
+   * @brief The indices of the sites of the partition in the alignment.
+   */
+  std::vector<size_t> sites;
+
+  Partition() : name(), sites() {}
+};
+
+/**
+ * @brief Likelihood of an alignment split into partitions, on a common tree.
+ *
+ * Each partition has its own substitution model and rate distribution, and
+ * its own likelihood object. The log-likelihood of the alignment is the sum
+ * of the log-likelihoods of all partitions.
+ *
+ * The topology is common to all partitions, and branch lengths are either
+ * shared, or proportionally linked: in the latter case, the branch lengths of
+ * each partition are the shared ones multiplied by a rate specific to the
+ * partition. The rate of the first partition is fixed to 1.
+ *
+ * Parameters are optimized by rounds. In each round, the model parameters of
+ * all partitions are optimized, then their rates if branch lengths are linked,
+ * then the shared branch lengths. As partitions only depend on each other
+ * through branch lengths, the first two steps are run concurrently on all
+ * partitions. Branch lengths are optimized jointly with a Newton-Raphson method,
+ * using the sum of the derivatives of all partitions, computed concurrently.
+ */
+class PartitionedTreeLikelihood
+{
+private:
+  std::vector<Partition> partitions_;
+  std::vector<TransitionModel*> models_;
+  std::vector<DiscreteDistribution*> rDists_;
+  std::vector<DRHomogeneousTreeLikelihood*> likelihoods_;
+  std::vector<double> rates_;
+  ParameterList brLens_;
+  bool proportional_;
+  unsigned int nbThreads_;
+
+public:
+  /**
+   * @brief Build a new partitioned likelihood.
+   *
+   * @param tree         The tree, with initial branch lengths. It is unrooted if needed.
+   * @param sites        The alignment.
+   * @param partitions   The partitions of the alignment.
+   * @param models       One model per partition. This object will own them.
+   * @param rDists       One rate distribution per partition. This object will own them.
+   * @param proportional Tell if branch lengths are proportionally linked, rather than shared.
+   * @param nbThreads    The number of partitions to process concurrently.
+   */
+  PartitionedTreeLikelihood(
+    const Tree& tree,
+    const SiteContainer& sites,
+    const std::vector<Partition>& partitions,
+    const std::vector<TransitionModel*>& models,
+    const std::vector<DiscreteDistribution*>& rDists,
+    bool proportional,
+    unsigned int nbThreads);
+
+  virtual ~PartitionedTreeLikelihood();
+
+private:
+  PartitionedTreeLikelihood(const PartitionedTreeLikelihood&);
+  PartitionedTreeLikelihood& operator=(const PartitionedTreeLikelihood&);
+
+public:
+  /**
+   * @brief Read partitions from a file.
+   *
+   * Each line has the form 'name = ranges', where ranges are comma-separated
+   * and written as 'position', 'first-last' or 'first-last\step', for instance
+   * 'codon3 = 3-1500\3'. Positions refer to the columns of the original
+   * alignment, starting at 1, so that they remain valid after sites were
+   * filtered. A prefix before a comma, as in 'DNA, gene1 = 1-500', is ignored.
+   * Empty lines and lines starting with '#' are ignored.
+   *
+   * @param path  The path of the partition file.
+   * @param sites The alignment to partition.
+   * @return The partitions, in file order. Empty partitions are discarded.
+   * @throw Exception If a site belongs to several partitions, or if the file is malformed.
+   */
+  static std::vector<Partition> readPartitions(const std::string& path, const SiteContainer& sites);
+
+  size_t getNumberOfPartitions() const { return partitions_.size(); }
+
+  const Partition& getPartition(size_t i) const { return partitions_[i]; }
+
+  const TransitionModel* getModel(size_t i) const { return models_[i]; }
+
+  const DiscreteDistribution* getRateDistribution(size_t i) const { return rDists_[i]; }
+
+  /**
+   * @return The branch length multiplier of a partition, 1 if branch lengths are shared.
+   */
+  double getRate(size_t i) const { return rates_[i]; }
+
+  double getLogLikelihood(size_t i) const { return -likelihoods_[i]->getValue(); }
+
+  double getLogLikelihood() const;
+
+  /**
+   * @return The tree with the shared branch lengths.
+   */
+  TreeTemplate<Node>* getTree() const;
+
+  /**
+   * @brief Optimize all parameters.
+   *
+   * @param tolerance The minimum improvement of the log-likelihood for a new round to be started.
+   * @param maxRounds The maximum number of rounds.
+   * @param verbose   Print the log-likelihood after each round.
+   * @return The number of rounds performed.
+   */
+  unsigned int optimize(double tolerance, unsigned int maxRounds, bool verbose);
+
+private:
+  /**
+   * @brief Set the branch lengths of a partition from the shared ones and a rate.
+   */
+  void setBranchLengths_(size_t i, double rate);
+
+  void optimizeModelParameters_(double tolerance);
+
+  void optimizeRates_(double tolerance);
+
+  void optimizeBranchLengths_(double tolerance);
+};
+} // end of namespace bpp.
+
+#endif // _BPPSUITE_PARTITIONEDTREELIKELIHOOD_H_
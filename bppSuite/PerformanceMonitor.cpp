@@ -0,0 +1,140 @@
+//
+// File: PerformanceMonitor.cpp
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "PerformanceMonitor.h"
+
+// From the STL:
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+
+using namespace std;
+
+using namespace bpp;
+
+/******************************************************************************/
+
+Stopwatch::Stopwatch(bool threadTime) :
+  threadTime_(threadTime),
+  wallStart_(chrono::steady_clock::now()),
+  cpuStart_(getCPUClock(threadTime))
+{}
+
+double Stopwatch::getWallTime() const
+{
+  return chrono::duration<double>(chrono::steady_clock::now() - wallStart_).count();
+}
+
+double Stopwatch::getCPUTime() const
+{
+  return getCPUClock(threadTime_) - cpuStart_;
+}
+
+double Stopwatch::getCPUClock(bool threadTime)
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID) && defined(CLOCK_PROCESS_CPUTIME_ID)
+  timespec ts;
+  if (clock_gettime(threadTime ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID, &ts) == 0)
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+#endif
+  // Per-thread CPU time is not available, the process time is used instead:
+  return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+}
+
+/******************************************************************************/
+
+atomic<unsigned long> PerformanceMonitor::valueCalls(0);
+atomic<unsigned long> PerformanceMonitor::firstOrderDerivativeCalls(0);
+atomic<unsigned long> PerformanceMonitor::secondOrderDerivativeCalls(0);
+atomic<unsigned long> PerformanceMonitor::transitionMatrices(0);
+
+/******************************************************************************/
+
+void PerformanceMonitor::start(const string& name)
+{
+  stop();
+  currentName_ = name;
+  current_.reset(new Stopwatch());
+}
+
+void PerformanceMonitor::stop()
+{
+  if (!current_) return;
+  addPhase(currentName_, *current_);
+  current_.reset();
+}
+
+void PerformanceMonitor::addPhase(const string& name, const Stopwatch& stopwatch)
+{
+  Phase phase;
+  phase.name = name;
+  phase.wallTime = stopwatch.getWallTime();
+  phase.cpuTime = stopwatch.getCPUTime();
+  lock_guard<mutex> lock(mutex_);
+  phases_.push_back(phase);
+}
+
+/******************************************************************************/
+
+void PerformanceMonitor::write(const string& path) const
+{
+  ofstream out(path.c_str(), ios::out);
+  if (!out)
+    throw Exception("PerformanceMonitor::write. Could not open file " + path);
+  out << setprecision(6) << fixed;
+  out << "{" << endl;
+  out << "  \"phases\": [" << endl;
+  lock_guard<mutex> lock(mutex_);
+  for (size_t i = 0; i < phases_.size(); ++i)
+  {
+    out << "    {\"name\": \"" << phases_[i].name << "\", \"wall_time\": " << phases_[i].wallTime << ", \"cpu_time\": " << phases_[i].cpuTime << "}";
+    out << (i + 1 < phases_.size() ? "," : "") << endl;
+  }
+  out << "  ]," << endl;
+  out << "  \"counters\": {" << endl;
+  out << "    \"value\": " << valueCalls << "," << endl;
+  out << "    \"first_order_derivative\": " << firstOrderDerivativeCalls << "," << endl;
+  out << "    \"second_order_derivative\": " << secondOrderDerivativeCalls << "," << endl;
+  out << "    \"transition_matrices\": " << transitionMatrices << endl;
+  out << "  }" << endl;
+  out << "}" << endl;
+}
+
+/******************************************************************************/
@@ -0,0 +1,202 @@
+//
+// File: PerformanceMonitor.h
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BPPSUITE_PERFORMANCEMONITOR_H_
+#define _BPPSUITE_PERFORMANCEMONITOR_H_
+
+// From the STL:
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// From bpp-core:
+#include <Bpp/Exceptions.h>
+
+// From bpp-phyl:
+#include <Bpp/Phyl/Node.h>
+
+namespace bpp
+{
+/**
+ * @brief Measure the wall-clock and CPU time elapsed since its creation.
+ */
+class Stopwatch
+{
+private:
+  bool threadTime_;
+  std::chrono::steady_clock::time_point wallStart_;
+  double cpuStart_;
+
+public:
+  /**
+   * @param threadTime If true, only count the CPU time of the calling thread,
+   * otherwise the CPU time of all threads of the process.
+   */
+  explicit Stopwatch(bool threadTime = false);
+
+  /**
+   * @return The wall-clock time elapsed, in seconds.
+   */
+  double getWallTime() const;
+
+  /**
+   * @return The CPU time elapsed, in seconds.
+   */
+  double getCPUTime() const;
+
+private:
+  static double getCPUClock(bool threadTime);
+};
+
+/**
+ * @brief Record the duration of the successive phases of a program, and count likelihood computations.
+ *
+ * Counters are global and thread-safe. They are updated by the likelihood
+ * objects wrapped in a CountingTreeLikelihood.
+ */
+class PerformanceMonitor
+{
+public:
+  static std::atomic<unsigned long> valueCalls;
+  static std::atomic<unsigned long> firstOrderDerivativeCalls;
+  static std::atomic<unsigned long> secondOrderDerivativeCalls;
+  static std::atomic<unsigned long> transitionMatrices;
+
+private:
+  struct Phase
+  {
+    std::string name;
+    double wallTime;
+    double cpuTime;
+  };
+
+  std::vector<Phase> phases_;
+  mutable std::mutex mutex_;
+  std::string currentName_;
+  std::unique_ptr<Stopwatch> current_;
+
+public:
+  PerformanceMonitor() : phases_(), mutex_(), currentName_(), current_() {}
+
+private:
+  PerformanceMonitor(const PerformanceMonitor&);
+  PerformanceMonitor& operator=(const PerformanceMonitor&);
+
+public:
+  /**
+   * @brief Start a new phase, stopping the current one if any.
+   *
+   * @param name The name of the phase.
+   */
+  void start(const std::string& name);
+
+  /**
+   * @brief Stop the current phase, if any, and record its duration.
+   */
+  void stop();
+
+  /**
+   * @brief Record a phase timed independently, for instance in another thread.
+   *
+   * This method is thread-safe.
+   *
+   * @param name      The name of the phase.
+   * @param stopwatch A stopwatch started at the beginning of the phase.
+   */
+  void addPhase(const std::string& name, const Stopwatch& stopwatch);
+
+  /**
+   * @brief Write all phases and counters to a file, in JSON format.
+   *
+   * @param path The path of the file.
+   */
+  void write(const std::string& path) const;
+};
+
+/**
+ * @brief Add counters to a likelihood class.
+ *
+ * Calls to getValue and to the derivatives are counted, as well as the
+ * transition matrices computed, one per rate class for each branch update.
+ * Computations performed by internal objects (the branch likelihoods used
+ * to test NNIs, or the sub-likelihoods of mixed models) are not counted.
+ */
+template<class TreeLikelihoodClass>
+class CountingTreeLikelihood :
+  public TreeLikelihoodClass
+{
+public:
+  using TreeLikelihoodClass::TreeLikelihoodClass;
+  using TreeLikelihoodClass::getSecondOrderDerivative;
+
+  CountingTreeLikelihood* clone() const { return new CountingTreeLikelihood(*this); }
+
+public:
+  double getValue() const throw (Exception)
+  {
+    PerformanceMonitor::valueCalls++;
+    return TreeLikelihoodClass::getValue();
+  }
+
+  double getFirstOrderDerivative(const std::string& variable) const throw (Exception)
+  {
+    PerformanceMonitor::firstOrderDerivativeCalls++;
+    return TreeLikelihoodClass::getFirstOrderDerivative(variable);
+  }
+
+  double getSecondOrderDerivative(const std::string& variable) const throw (Exception)
+  {
+    PerformanceMonitor::secondOrderDerivativeCalls++;
+    return TreeLikelihoodClass::getSecondOrderDerivative(variable);
+  }
+
+protected:
+  void computeTransitionProbabilitiesForNode(const Node* node)
+  {
+    PerformanceMonitor::transitionMatrices += this->getRateDistribution()->getNumberOfCategories();
+    TreeLikelihoodClass::computeTransitionProbabilitiesForNode(node);
+  }
+};
+} // end of namespace bpp.
+
+#endif // _BPPSUITE_PERFORMANCEMONITOR_H_
@@ -0,0 +1,370 @@
+//
+// File: SiteFilterTools.cpp
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "SiteFilterTools.h"
+
+// From the STL:
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// From bpp-core:
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Exceptions.h>
+#include <Bpp/Numeric/NumConstants.h>
+#include <Bpp/Text/TextTools.h>
+
+// From bpp-seq:
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Alphabet/CodonAlphabet.h>
+#include <Bpp/Seq/App/SequenceApplicationTools.h>
+#include <Bpp/Seq/Container/SiteContainerTools.h>
+#include <Bpp/Seq/GeneticCode/GeneticCode.h>
+#include <Bpp/Seq/Io/BppOAlignmentReaderFormat.h>
+#include <Bpp/Seq/Io/ISequence.h>
+#include <Bpp/Seq/SiteTools.h>
+
+using namespace bpp;
+
+/******************************************************************************/
+
+void SiteFilterTools::removeSites(VectorSiteContainer& sites, const vector<bool>& toRemove)
+{
+  size_t nbSites = sites.getNumberOfSites();
+  if (toRemove.size() != nbSites)
+    throw Exception("SiteFilterTools::removeSites. The selection does not match the number of sites.");
+  vector<Site*> kept;
+  for (size_t i = nbSites; i > 0; --i)
+  {
+    Site* site = sites.removeSite(i - 1);
+    if (toRemove[i - 1])
+      delete site;
+    else
+      kept.push_back(site);
+  }
+  for (size_t i = kept.size(); i > 0; --i)
+  {
+    sites.addSite(*kept[i - 1], false);
+    delete kept[i - 1];
+  }
+}
+
+/******************************************************************************/
+
+namespace
+{
+/**
+ * @brief Read a maximum number of sequences, given either as a count or as a percentage.
+ *
+ * @return The maximum number of sequences, as a real number so that percentages are not rounded.
+ */
+double getMaximumCount(const string& option, size_t nbSequences)
+{
+  if (option[option.size() - 1] == '%')
+    return TextTools::toDouble(option.substr(0, option.size() - 1)) / 100. * static_cast<double>(nbSequences);
+  return static_cast<double>(TextTools::to<size_t>(option));
+}
+
+/**
+ * @brief The options selecting the sites to analyse, read once and applied to each site.
+ */
+class SiteSelection
+{
+private:
+  const Alphabet* alphabet_;
+  string option_;
+  double maxGaps_;
+  double maxUnresolved_;
+  bool isCodon_;
+  unique_ptr<GeneticCode> gCode_;
+
+public:
+  SiteSelection(
+    const Alphabet* alphabet,
+    size_t nbSequences,
+    map<string, string>& params,
+    const string& suffix,
+    bool suffixIsOptional,
+    bool verbose,
+    int warn) :
+    alphabet_(alphabet),
+    option_(ApplicationTools::getStringParameter("input.sequence.sites_to_use", params, "complete", suffix, suffixIsOptional, warn)),
+    maxGaps_(static_cast<double>(nbSequences)),
+    maxUnresolved_(static_cast<double>(nbSequences)),
+    isCodon_(false),
+    gCode_()
+  {
+    if (verbose)
+      ApplicationTools::displayResult("Sites to use", option_);
+    if (option_ == "all")
+    {
+      string maxGapOption = ApplicationTools::getStringParameter("input.sequence.max_gap_allowed", params, "100%", suffix, suffixIsOptional, warn);
+      string maxUnresolvedOption = ApplicationTools::getStringParameter("input.sequence.max_unresolved_allowed", params, "100%", suffix, suffixIsOptional, warn);
+      maxGaps_ = getMaximumCount(maxGapOption, nbSequences) + NumConstants::TINY();
+      maxUnresolved_ = getMaximumCount(maxUnresolvedOption, nbSequences) + NumConstants::TINY();
+    }
+    else if (option_ != "complete" && option_ != "nogap")
+      throw Exception("Option '" + option_ + "' unknown in parameter 'input.sequence.sites_to_use'.");
+
+    const CodonAlphabet* codonAlphabet = dynamic_cast<const CodonAlphabet*>(alphabet);
+    if (codonAlphabet)
+    {
+      isCodon_ = true;
+      if (ApplicationTools::getBooleanParameter("input.sequence.remove_stop_codons", params, true, suffix, suffixIsOptional, warn))
+      {
+        string codeDesc = ApplicationTools::getStringParameter("genetic_code", params, "Standard", "", true, warn);
+        gCode_.reset(SequenceApplicationTools::getGeneticCode(codonAlphabet->getNucleicAlphabet(), codeDesc));
+      }
+    }
+  }
+
+private:
+  SiteSelection(const SiteSelection&);
+  SiteSelection& operator=(const SiteSelection&);
+
+public:
+  bool usesAllSites() const { return option_ == "all"; }
+
+  /**
+   * @return True if the site passes the 'input.sequence.sites_to_use' criteria.
+   */
+  bool isUsable(const Site& site) const
+  {
+    if (option_ == "complete")
+      return SiteTools::isComplete(site);
+    if (option_ == "nogap")
+      return !SiteTools::hasGap(site);
+    int gapCode = alphabet_->getGapCharacterCode();
+    size_t nbGaps = 0;
+    size_t nbUnresolved = 0;
+    for (size_t j = 0; j < site.size(); ++j)
+    {
+      int state = site[j];
+      if (state == gapCode)
+        nbGaps++;
+      else if (alphabet_->isUnresolved(state))
+        nbUnresolved++;
+    }
+    return static_cast<double>(nbGaps) <= maxGaps_ && static_cast<double>(nbUnresolved) <= maxUnresolved_;
+  }
+
+  /**
+   * @return True if stop codons are removed and the site has one.
+   */
+  bool hasStopCodon(const Site& site) const
+  {
+    if (!gCode_) return false;
+    for (size_t j = 0; j < site.size(); ++j)
+    {
+      if (gCode_->isStop(site[j])) return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Print the same information as SequenceApplicationTools::getSitesToAnalyse.
+   *
+   * @param nbUsable The number of sites passing the 'input.sequence.sites_to_use' criteria.
+   */
+  void displayResults(size_t nbUsable) const
+  {
+    if (option_ == "complete")
+      ApplicationTools::displayResult("Complete sites", TextTools::toString(nbUsable));
+    else if (option_ == "nogap")
+      ApplicationTools::displayResult("Sites without gap", TextTools::toString(nbUsable));
+    if (isCodon_)
+      ApplicationTools::displayBooleanResult("Remove stop codons", gCode_.get() != 0);
+  }
+};
+}
+
+/******************************************************************************/
+
+void SiteFilterTools::filterSitesToAnalyse(
+  VectorSiteContainer& sites,
+  map<string, string>& params,
+  const string& suffix,
+  bool suffixIsOptional,
+  bool gapAsUnknown,
+  bool verbose,
+  int warn)
+{
+  SiteSelection selection(sites.getAlphabet(), sites.getNumberOfSequences(), params, suffix, suffixIsOptional, verbose, warn);
+  size_t nbSites = sites.getNumberOfSites();
+  vector<bool> toRemove(nbSites, false);
+  size_t nbUsable = 0;
+  for (size_t i = 0; i < nbSites; ++i)
+  {
+    const Site& site = sites.getSite(i);
+    if (selection.isUsable(site))
+    {
+      nbUsable++;
+      toRemove[i] = selection.hasStopCodon(site);
+    }
+    else
+      toRemove[i] = true;
+  }
+  if (verbose)
+    selection.displayResults(nbUsable);
+
+  if (find(toRemove.begin(), toRemove.end(), true) != toRemove.end())
+    removeSites(sites, toRemove);
+  if (selection.usesAllSites() && gapAsUnknown)
+    SiteContainerTools::changeGapsToUnknownCharacters(sites);
+}
+
+/******************************************************************************/
+
+VectorSiteContainer* SiteFilterTools::getSitesToAnalyse(
+  const Alphabet* alphabet,
+  map<string, string>& params,
+  const string& suffix,
+  bool suffixIsOptional,
+  bool gapAsUnknown,
+  bool verbose,
+  int warn)
+{
+  string sequenceFilePath = ApplicationTools::getAFilePath("input.sequence.file", params, true, true, suffix, suffixIsOptional, "none", warn);
+  string sequenceFormat = ApplicationTools::getStringParameter("input.sequence.format", params, "Fasta()", suffix, suffixIsOptional, warn);
+  string siteSet = ApplicationTools::getStringParameter("input.site.selection", params, "none", suffix, suffixIsOptional, warn + 1);
+  BppOAlignmentReaderFormat bppoReader(warn);
+  unique_ptr<IAlignment> iAln(bppoReader.read(sequenceFormat));
+
+  // Site selections, Mase site sets and RNY alphabets are only supported by the library reader,
+  // which holds two copies of the alignment. Its result is then filtered in place:
+  if (siteSet != "none" || iAln->getFormatName() == "MASE file" || AlphabetTools::isRNYAlphabet(alphabet))
+  {
+    unique_ptr<VectorSiteContainer> sites(SequenceApplicationTools::getSiteContainer(alphabet, params, suffix, suffixIsOptional, verbose, warn));
+    filterSitesToAnalyse(*sites, params, suffix, suffixIsOptional, gapAsUnknown, verbose, warn);
+    return sites.release();
+  }
+
+  if (verbose)
+  {
+    ApplicationTools::displayResult("Sequence file " + suffix, sequenceFilePath);
+    ApplicationTools::displayResult("Sequence format " + suffix, iAln->getFormatName());
+  }
+  unique_ptr<SequenceContainer> alignment(iAln->readAlignment(sequenceFilePath, alphabet));
+  SiteContainer& alignedSites = dynamic_cast<SiteContainer&>(*alignment);
+  vector<string> names = alignedSites.getSequencesNames();
+  size_t nbSequences = names.size();
+  size_t nbSites = alignedSites.getNumberOfSites();
+  vector<int> positions = alignedSites.getSitePositions();
+  Comments comments = alignedSites.getGeneralComments();
+  SiteSelection selection(alphabet, nbSequences, params, suffix, suffixIsOptional, verbose, warn);
+
+  // Select the sites, one column at a time:
+  vector<const Sequence*> sequences(nbSequences);
+  for (size_t j = 0; j < nbSequences; ++j)
+  {
+    sequences[j] = &alignedSites.getSequence(j);
+  }
+  vector<size_t> selected;
+  vector<int> states(nbSequences);
+  size_t nbUsable = 0;
+  for (size_t i = 0; i < nbSites; ++i)
+  {
+    for (size_t j = 0; j < nbSequences; ++j)
+    {
+      states[j] = (*sequences[j])[i];
+    }
+    Site site(states, alphabet, positions[i]);
+    if (!selection.isUsable(site)) continue;
+    nbUsable++;
+    if (!selection.hasStopCodon(site))
+      selected.push_back(i);
+  }
+  if (verbose)
+    selection.displayResults(nbUsable);
+
+  // The selected states of each sequence are extracted, and the sequence is deleted right away,
+  // so that the alignment read shrinks as the selected data grow:
+  size_t nbSelected = selected.size();
+  vector< vector<int> > selectedStates(nbSequences);
+  for (size_t j = 0; j < nbSequences; ++j)
+  {
+    selectedStates[j].reserve(nbSelected);
+    for (size_t k = 0; k < nbSelected; ++k)
+    {
+      selectedStates[j].push_back((*sequences[j])[selected[k]]);
+    }
+    alignedSites.deleteSequence(names[j]);
+  }
+  alignment.reset();
+
+  // Sites are built from the last one, and the selected states are released as they are used:
+  vector< unique_ptr<Site> > built(nbSelected);
+  size_t capacity = nbSelected;
+  for (size_t k = nbSelected; k > 0; --k)
+  {
+    for (size_t j = 0; j < nbSequences; ++j)
+    {
+      states[j] = selectedStates[j].back();
+      selectedStates[j].pop_back();
+    }
+    built[k - 1].reset(new Site(states, alphabet, positions[selected[k - 1]]));
+    if (k - 1 < capacity / 8 * 7)
+    {
+      for (size_t j = 0; j < nbSequences; ++j)
+      {
+        selectedStates[j].shrink_to_fit();
+      }
+      capacity = k - 1;
+    }
+  }
+  selectedStates.clear();
+
+  // The container copies the sites it is given, so they are added and deleted one by one:
+  unique_ptr<VectorSiteContainer> sites(new VectorSiteContainer(names, alphabet));
+  sites->setGeneralComments(comments);
+  for (size_t k = 0; k < nbSelected; ++k)
+  {
+    sites->addSite(*built[k], false);
+    built[k].reset();
+  }
+
+  if (selection.usesAllSites() && gapAsUnknown)
+    SiteContainerTools::changeGapsToUnknownCharacters(*sites);
+  return sites.release();
+}
+
+/******************************************************************************/
@@ -0,0 +1,139 @@
+//
+// File: SiteFilterTools.h
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BPPSUITE_SITEFILTERTOOLS_H_
+#define _BPPSUITE_SITEFILTERTOOLS_H_
+
+// From the STL:
+#include <map>
+#include <string>
+#include <vector>
+
+// From bpp-seq:
+#include <Bpp/Seq/Alphabet/Alphabet.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+
+namespace bpp
+{
+/**
+ * @brief Tools for filtering the sites of an alignment without copying it.
+ */
+class SiteFilterTools
+{
+public:
+  /**
+   * @brief Remove a set of sites from a container.
+   *
+   * Calling deleteSite for each site costs a time proportional to the number
+   * of remaining sites, which makes removing many sites quadratic.
+   * Here, sites are taken from the end of the container, and the ones to keep
+   * are put back in their original order, in linear time. The kept sites are
+   * held by pointer while the container is emptied, and copied back one at a
+   * time, so that only one site is duplicated at any time.
+   *
+   * @param sites    The container to filter.
+   * @param toRemove For each site, tell if it should be removed.
+   */
+  static void removeSites(VectorSiteContainer& sites, const std::vector<bool>& toRemove);
+
+  /**
+   * @brief Remove the sites that should not be analysed, in place.
+   *
+   * This applies the same options as SequenceApplicationTools::getSitesToAnalyse
+   * ('input.sequence.sites_to_use', 'input.sequence.max_gap_allowed',
+   * 'input.sequence.max_unresolved_allowed' and 'input.sequence.remove_stop_codons'),
+   * with the same results, but without copying the alignment.
+   * Sites keep their original positions.
+   *
+   * @param sites            The container to filter.
+   * @param params           The attribute map where options may be found.
+   * @param suffix           A suffix to be applied to each attribute name.
+   * @param suffixIsOptional Tell if the suffix is absolutely required.
+   * @param gapAsUnknown     Convert gaps to unknown characters (only when all sites are used).
+   * @param verbose          Print some info to the 'message' output stream.
+   * @param warn             Warning level.
+   */
+  static void filterSitesToAnalyse(
+    VectorSiteContainer& sites,
+    std::map<std::string, std::string>& params,
+    const std::string& suffix = "",
+    bool suffixIsOptional = true,
+    bool gapAsUnknown = true,
+    bool verbose = true,
+    int warn = 1);
+
+  /**
+   * @brief Read an alignment and remove the sites that should not be analysed.
+   *
+   * This replaces the SequenceApplicationTools::getSiteContainer and
+   * SequenceApplicationTools::getSitesToAnalyse pair, which holds the
+   * alignment read, a copy of it as a VectorSiteContainer, and the filtered
+   * sites. Here, the sites to keep are selected on the alignment read, with
+   * the same options and output as filterSitesToAnalyse. Their states are
+   * then moved out of it one sequence at a time, each sequence being deleted
+   * once done, and the sites are built while these states are released.
+   * Apart from a few sequences or sites, the data are hence only held once.
+   *
+   * Site selections ('input.site.selection'), Mase files and RNY alphabets
+   * are only handled by SequenceApplicationTools::getSiteContainer, which
+   * is then used and its result filtered in place. This still holds two
+   * copies of the alignment while reading it.
+   *
+   * @param alphabet         The alphabet to use.
+   * @param params           The attribute map where options may be found.
+   * @param suffix           A suffix to be applied to each attribute name.
+   * @param suffixIsOptional Tell if the suffix is absolutely required.
+   * @param gapAsUnknown     Convert gaps to unknown characters (only when all sites are used).
+   * @param verbose          Print some info to the 'message' output stream.
+   * @param warn             Warning level.
+   * @return A new container with the sites to analyse.
+   */
+  static VectorSiteContainer* getSitesToAnalyse(
+    const Alphabet* alphabet,
+    std::map<std::string, std::string>& params,
+    const std::string& suffix = "",
+    bool suffixIsOptional = true,
+    bool gapAsUnknown = true,
+    bool verbose = true,
+    int warn = 1);
+};
+} // end of namespace bpp.
+
+#endif // _BPPSUITE_SITEFILTERTOOLS_H_
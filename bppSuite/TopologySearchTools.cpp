@@ -0,0 +1,968 @@
+//
+// File: TopologySearchTools.cpp
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "TopologySearchTools.h"
+
+// From the STL:
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+
+using namespace std;
+
+// From bpp-core:
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Exceptions.h>
+#include <Bpp/Numeric/Matrix/Matrix.h>
+#include <Bpp/Text/TextTools.h>
+
+// From bpp-phyl:
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/NNIHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/OptimizationTools.h>
+
+// From bppsuite:
+#include "BootstrapTools.h"
+#include "ParallelTools.h"
+#include "PerformanceMonitor.h"
+
+using namespace bpp;
+
+/******************************************************************************/
+
+namespace
+{
+/**
+ * @brief Conditional likelihoods of all subtrees of a tree, used to score SPR moves.
+ *
+ * For each node but the root, the 'lower' array holds the likelihoods of the
+ * subtree below the node, and the 'upper' array those of the rest of the
+ * tree, at the father of the node. Arrays are indexed by site pattern, rate
+ * class and state. They are rescaled for each pattern, the logarithms of
+ * the scaling factors being stored apart.
+ *
+ * An SPR move only changes the arrays on the path between the pruning and
+ * regrafting points: they are computed one branch at a time, walking away
+ * from the pruning point, so that all the regrafting points of a subtree
+ * are scored for the cost of one array update each. Branch lengths are
+ * kept fixed: the regrafting branch is split in two halves, and the subtree
+ * keeps the length of its own branch.
+ *
+ * Arrays are only read once computed, so that several threads can score
+ * moves concurrently, each with its own copy of the model, which caches
+ * transition probabilities.
+ */
+class SPRScorer
+{
+public:
+  struct Array
+  {
+    vector<double> values;
+    vector<double> logScales;
+
+    Array() : values(), logScales() {}
+  };
+
+private:
+  size_t nbPatterns_;
+  size_t nbClasses_;
+  size_t nbStates_;
+  vector<double> rates_;
+  vector<double> classProbabilities_;
+  vector<double> frequencies_;
+  vector<double> weights_;
+  map<int, Array> lower_;
+  map<int, Array> upper_;
+
+public:
+  SPRScorer(const TreeTemplate<Node>& tree, const SiteContainer& sites, const TransitionModel& model, const DiscreteDistribution& rDist) :
+    nbPatterns_(0),
+    nbClasses_(rDist.getNumberOfCategories()),
+    nbStates_(model.getNumberOfStates()),
+    rates_(),
+    classProbabilities_(),
+    frequencies_(model.getFrequencies()),
+    weights_(),
+    lower_(),
+    upper_()
+  {
+    for (size_t c = 0; c < nbClasses_; ++c)
+    {
+      rates_.push_back(rDist.getCategory(c));
+      classProbabilities_.push_back(rDist.getProbability(c));
+    }
+
+    // Distinct site patterns:
+    map<vector<int>, size_t> patternIndex;
+    vector< vector<int> > patterns;
+    for (size_t i = 0; i < sites.getNumberOfSites(); ++i)
+    {
+      const vector<int>& states = sites.getSite(i).getContent();
+      pair<map<vector<int>, size_t>::iterator, bool> inserted = patternIndex.insert(make_pair(states, patterns.size()));
+      if (inserted.second)
+      {
+        patterns.push_back(states);
+        weights_.push_back(0);
+      }
+      weights_[inserted.first->second]++;
+    }
+    nbPatterns_ = patterns.size();
+    vector<string> names = sites.getSequencesNames();
+    map<string, size_t> sequenceIndex;
+    for (size_t j = 0; j < names.size(); ++j)
+    {
+      sequenceIndex[names[j]] = j;
+    }
+
+    // Fathers come before their sons in this list:
+    vector<const Node*> nodes(1, tree.getRootNode());
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+      for (size_t j = 0; j < nodes[i]->getNumberOfSons(); ++j)
+      {
+        nodes.push_back(nodes[i]->getSon(j));
+      }
+    }
+
+    // Lower arrays, from the leaves to the root:
+    for (size_t i = nodes.size(); i > 1; --i)
+    {
+      const Node* node = nodes[i - 1];
+      Array& array = lower_[node->getId()];
+      if (node->isLeaf())
+      {
+        map<string, size_t>::const_iterator it = sequenceIndex.find(node->getName());
+        if (it == sequenceIndex.end())
+          throw Exception("SPRScorer. No sequence found for leaf " + node->getName());
+        array = getOnes();
+        for (size_t p = 0; p < nbPatterns_; ++p)
+        {
+          int state = patterns[p][it->second];
+          for (size_t c = 0; c < nbClasses_; ++c)
+          {
+            for (size_t s = 0; s < nbStates_; ++s)
+            {
+              array.values[(p * nbClasses_ + c) * nbStates_ + s] = model.getInitValue(s, state);
+            }
+          }
+        }
+      }
+      else
+      {
+        array = getOnes();
+        for (size_t j = 0; j < node->getNumberOfSons(); ++j)
+        {
+          multiply(array, propagate(lower_[node->getSon(j)->getId()], node->getSon(j)->getDistanceToFather(), model));
+        }
+      }
+    }
+
+    // Upper arrays, from the root to the leaves:
+    for (size_t i = 1; i < nodes.size(); ++i)
+    {
+      const Node* node = nodes[i];
+      const Node* father = node->getFather();
+      Array& array = upper_[node->getId()];
+      array = getOnes();
+      for (size_t j = 0; j < father->getNumberOfSons(); ++j)
+      {
+        const Node* sibling = father->getSon(j);
+        if (sibling != node)
+          multiply(array, propagate(lower_[sibling->getId()], sibling->getDistanceToFather(), model));
+      }
+      if (father->hasFather())
+        multiply(array, propagate(upper_[father->getId()], father->getDistanceToFather(), model));
+    }
+  }
+
+  /**
+   * @return The log-likelihood of the tree the arrays were computed for.
+   */
+  double getLogLikelihood(const TreeTemplate<Node>& tree, const TransitionModel& model) const
+  {
+    const Node* root = tree.getRootNode();
+    Array array = getOnes();
+    for (size_t j = 0; j < root->getNumberOfSons(); ++j)
+    {
+      multiply(array, propagate(lower_.find(root->getSon(j)->getId())->second, root->getSon(j)->getDistanceToFather(), model));
+    }
+    return getLogLikelihood(array);
+  }
+
+  /**
+   * @brief Score all the regrafting points of a subtree within a given radius.
+   *
+   * Regrafting points are the ones listed by TopologySearchTools::getSPRMoves.
+   *
+   * @param pruned  The root of the subtree to move.
+   * @param radius  The maximum regrafting distance.
+   * @param model   The model to use for transition probabilities.
+   * @param scores  [out] For each target node, the log-likelihood of the move.
+   * @param touched [out] For each target node, the nodes the move depends on.
+   */
+  void scoreMoves(
+    const Node* pruned,
+    unsigned int radius,
+    const TransitionModel& model,
+    map<int, double>& scores,
+    map<int, vector<int> >& touched) const
+  {
+    const Node* father = pruned->getFather();
+    Array prunedArray = propagate(lower_.find(pruned->getId())->second, pruned->getDistanceToFather(), model);
+
+    // Nodes around the pruning point are changed by all moves of this subtree:
+    vector<int> pruningPoint(1, pruned->getId());
+    pruningPoint.push_back(father->getId());
+    if (father->hasFather())
+      pruningPoint.push_back(father->getFather()->getId());
+    for (size_t j = 0; j < father->getNumberOfSons(); ++j)
+    {
+      pruningPoint.push_back(father->getSon(j)->getId());
+    }
+
+    // Each step holds the array of the pruned tree on the side of the pruning point, at the node reached:
+    struct Step
+    {
+      const Node* node;
+      const Node* from;
+      Array incoming;
+      unsigned int distance;
+      vector<int> path;
+    };
+    deque<Step> queue;
+    queue.push_back(Step{ father, pruned, getOnes(), 0, pruningPoint });
+    while (!queue.empty())
+    {
+      Step step = queue.front();
+      queue.pop_front();
+      const Node* node = step.node;
+
+      // Arrays of the neighbors on the other side, brought to the node:
+      vector<const Node*> neighbors;
+      vector<double> lengths;
+      vector<const Array*> arrays;
+      if (node->hasFather() && node->getFather() != step.from)
+      {
+        neighbors.push_back(node->getFather());
+        lengths.push_back(node->getDistanceToFather());
+        arrays.push_back(&upper_.find(node->getId())->second);
+      }
+      for (size_t j = 0; j < node->getNumberOfSons(); ++j)
+      {
+        const Node* son = node->getSon(j);
+        if (son == step.from) continue;
+        neighbors.push_back(son);
+        lengths.push_back(son->getDistanceToFather());
+        arrays.push_back(&lower_.find(son->getId())->second);
+      }
+      vector<Array> propagated(neighbors.size());
+      for (size_t k = 0; k < neighbors.size(); ++k)
+      {
+        propagated[k] = propagate(*arrays[k], lengths[k], model);
+      }
+
+      for (size_t k = 0; k < neighbors.size(); ++k)
+      {
+        // The array of the pruned tree at the node, on all sides but the neighbor's:
+        Array side = step.incoming;
+        for (size_t l = 0; l < neighbors.size(); ++l)
+        {
+          if (l != k)
+            multiply(side, propagated[l]);
+        }
+        unsigned int distance = step.distance + 1;
+        vector<int> path = step.path;
+        path.push_back(neighbors[k]->getId());
+        if (distance >= 2)
+        {
+          const Node* target = (neighbors[k]->hasFather() && neighbors[k]->getFather() == node) ? neighbors[k] : node;
+          Array inserted = propagate(side, lengths[k] / 2., model);
+          multiply(inserted, propagate(*arrays[k], lengths[k] / 2., model));
+          multiply(inserted, prunedArray);
+          scores[target->getId()] = getLogLikelihood(inserted);
+          touched[target->getId()] = path;
+        }
+        if (distance <= radius)
+          queue.push_back(Step{ neighbors[k], node, propagate(side, lengths[k], model), distance, path });
+      }
+    }
+  }
+
+private:
+  Array getOnes() const
+  {
+    Array array;
+    array.values.assign(nbPatterns_ * nbClasses_ * nbStates_, 1.);
+    array.logScales.assign(nbPatterns_, 0.);
+    return array;
+  }
+
+  /**
+   * @return The array at the father of a branch, given the one at its son.
+   */
+  Array propagate(const Array& array, double length, const TransitionModel& model) const
+  {
+    Array result;
+    result.values.assign(array.values.size(), 0.);
+    result.logScales = array.logScales;
+    vector<double> probabilities(nbStates_ * nbStates_);
+    for (size_t c = 0; c < nbClasses_; ++c)
+    {
+      const Matrix<double>& pij = model.getPij_t(length * rates_[c]);
+      for (size_t i = 0; i < nbStates_; ++i)
+      {
+        for (size_t j = 0; j < nbStates_; ++j)
+        {
+          probabilities[i * nbStates_ + j] = pij(i, j);
+        }
+      }
+      for (size_t p = 0; p < nbPatterns_; ++p)
+      {
+        size_t offset = (p * nbClasses_ + c) * nbStates_;
+        for (size_t i = 0; i < nbStates_; ++i)
+        {
+          double value = 0;
+          for (size_t j = 0; j < nbStates_; ++j)
+          {
+            value += probabilities[i * nbStates_ + j] * array.values[offset + j];
+          }
+          result.values[offset + i] = value;
+        }
+      }
+    }
+    return result;
+  }
+
+  void multiply(Array& array, const Array& other) const
+  {
+    size_t blockSize = nbClasses_ * nbStates_;
+    for (size_t p = 0; p < nbPatterns_; ++p)
+    {
+      double maximum = 0;
+      for (size_t k = p * blockSize; k < (p + 1) * blockSize; ++k)
+      {
+        array.values[k] *= other.values[k];
+        maximum = max(maximum, array.values[k]);
+      }
+      array.logScales[p] += other.logScales[p];
+      // Rescale, so that large trees do not underflow:
+      if (maximum > 0)
+      {
+        for (size_t k = p * blockSize; k < (p + 1) * blockSize; ++k)
+        {
+          array.values[k] /= maximum;
+        }
+        array.logScales[p] += log(maximum);
+      }
+    }
+  }
+
+  /**
+   * @return The log-likelihood of the tree, given the array at any of its nodes.
+   */
+  double getLogLikelihood(const Array& array) const
+  {
+    double logL = 0;
+    for (size_t p = 0; p < nbPatterns_; ++p)
+    {
+      double likelihood = 0;
+      for (size_t c = 0; c < nbClasses_; ++c)
+      {
+        size_t offset = (p * nbClasses_ + c) * nbStates_;
+        for (size_t s = 0; s < nbStates_; ++s)
+        {
+          likelihood += classProbabilities_[c] * frequencies_[s] * array.values[offset + s];
+        }
+      }
+      logL += weights_[p] * (log(likelihood) + array.logScales[p]);
+    }
+    return logL;
+  }
+};
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* TopologySearchTools::getRandomTree(const vector<string>& leavesNames, mt19937& generator)
+{
+  if (leavesNames.empty())
+    throw Exception("TopologySearchTools::getRandomTree. No leaf name given.");
+  vector<Node*> nodes;
+  int id = 0;
+  for (size_t i = 0; i < leavesNames.size(); ++i)
+  {
+    nodes.push_back(new Node(id++, leavesNames[i]));
+  }
+  // Two random subtrees are joined until only one is left:
+  while (nodes.size() > 1)
+  {
+    size_t pos1 = uniform_int_distribution<size_t>(0, nodes.size() - 1)(generator);
+    Node* node1 = nodes[pos1];
+    nodes.erase(nodes.begin() + static_cast<ptrdiff_t>(pos1));
+    size_t pos2 = uniform_int_distribution<size_t>(0, nodes.size() - 1)(generator);
+    Node* node2 = nodes[pos2];
+    nodes.erase(nodes.begin() + static_cast<ptrdiff_t>(pos2));
+    Node* parent = new Node(id++);
+    parent->addSon(node1);
+    parent->addSon(node2);
+    nodes.push_back(parent);
+  }
+  return new TreeTemplate<Node>(nodes[0]);
+}
+
+/******************************************************************************/
+
+vector<SPRMove> TopologySearchTools::getSPRMoves(const TreeTemplate<Node>& tree, unsigned int radius)
+{
+  vector<SPRMove> moves;
+  vector<const Node*> nodes = tree.getNodes();
+  for (size_t i = 0; i < nodes.size(); ++i)
+  {
+    const Node* pruned = nodes[i];
+    if (!pruned->hasFather()) continue;
+    const Node* father = pruned->getFather();
+    // Breadth-first search from the pruning point, without entering the pruned subtree.
+    // Branches incident to the father correspond to the original position and are skipped.
+    map<const Node*, unsigned int> distances;
+    distances[father] = 0;
+    deque<const Node*> queue(1, father);
+    while (!queue.empty())
+    {
+      const Node* node = queue.front();
+      queue.pop_front();
+      unsigned int d = distances[node] + 1;
+      vector<const Node*> neighbors;
+      if (node->hasFather())
+        neighbors.push_back(node->getFather());
+      for (size_t j = 0; j < node->getNumberOfSons(); ++j)
+      {
+        neighbors.push_back(node->getSon(j));
+      }
+      for (size_t j = 0; j < neighbors.size(); ++j)
+      {
+        const Node* neighbor = neighbors[j];
+        if (neighbor == pruned || distances.find(neighbor) != distances.end()) continue;
+        distances[neighbor] = d;
+        if (d >= 2)
+        {
+          const Node* below = (neighbor->hasFather() && neighbor->getFather() == node) ? neighbor : node;
+          moves.push_back(SPRMove(pruned->getId(), below->getId()));
+        }
+        if (d <= radius)
+          queue.push_back(neighbor);
+      }
+    }
+  }
+  return moves;
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* TopologySearchTools::applySPRMove(const TreeTemplate<Node>& tree, const SPRMove& move, vector<int>& modified)
+{
+  unique_ptr< TreeTemplate<Node> > result(new TreeTemplate<Node>(tree));
+  int newId = TreeTemplateTools::getMaxId(*result->getRootNode()) + 1;
+  Node* pruned = result->getNode(move.pruned);
+  Node* target = result->getNode(move.target);
+  Node* father = pruned->getFather();
+
+  // Prune:
+  father->removeSon(pruned);
+  if (father->hasFather() && father->getNumberOfSons() == 1)
+  {
+    // The father is now useless, its remaining son is connected to the grand father:
+    Node* son = father->getSon(0);
+    Node* grandFather = father->getFather();
+    size_t pos = grandFather->getSonPosition(father);
+    double length = son->getDistanceToFather() + father->getDistanceToFather();
+    father->removeSon(son);
+    grandFather->removeSon(father);
+    grandFather->addSon(pos, son);
+    son->setDistanceToFather(length);
+    delete father;
+  }
+
+  // Regraft:
+  Node* targetFather = target->getFather();
+  size_t pos = targetFather->getSonPosition(target);
+  double length = target->getDistanceToFather() / 2.;
+  targetFather->removeSon(target);
+  Node* inserted = new Node(newId);
+  inserted->addSon(target);
+  inserted->addSon(pruned);
+  targetFather->addSon(pos, inserted);
+  inserted->setDistanceToFather(length);
+  target->setDistanceToFather(length);
+
+  // If the subtree was attached to the root, the root is now bifurcating:
+  if (result->isRooted())
+    result->unroot();
+
+  modified.clear();
+  int ids[3] = { move.target, move.pruned, newId };
+  for (size_t i = 0; i < 3; ++i)
+  {
+    if (result->hasNode(ids[i]) && result->getNode(ids[i])->hasFather())
+      modified.push_back(ids[i]);
+  }
+  return result.release();
+}
+
+/******************************************************************************/
+
+vector<NNIMove> TopologySearchTools::getNNIMoves(const TreeTemplate<Node>& tree)
+{
+  vector<NNIMove> moves;
+  vector<const Node*> nodes = tree.getInnerNodes();
+  for (size_t i = 0; i < nodes.size(); ++i)
+  {
+    const Node* node = nodes[i];
+    if (!node->hasFather() || node->getNumberOfSons() != 2) continue;
+    const Node* father = node->getFather();
+    // Any other subtree around the father gives the two alternative topologies:
+    const Node* sibling = father->getSon(0) == node ? father->getSon(1) : father->getSon(0);
+    moves.push_back(NNIMove(node->getSon(0)->getId(), sibling->getId()));
+    moves.push_back(NNIMove(node->getSon(1)->getId(), sibling->getId()));
+  }
+  return moves;
+}
+
+/******************************************************************************/
+
+void TopologySearchTools::applyNNIMove(TreeTemplate<Node>& tree, const NNIMove& move)
+{
+  Node* son = tree.getNode(move.son);
+  Node* sibling = tree.getNode(move.sibling);
+  Node* node = son->getFather();
+  Node* father = sibling->getFather();
+  size_t sonPos = node->getSonPosition(son);
+  size_t siblingPos = father->getSonPosition(sibling);
+  node->removeSon(son);
+  father->removeSon(sibling);
+  node->addSon(sonPos, sibling);
+  father->addSon(siblingPos, son);
+}
+
+/******************************************************************************/
+
+vector<int> TopologySearchTools::getNNINeighborhood(const TreeTemplate<Node>& tree, const NNIMove& move)
+{
+  const Node* node = tree.getNode(move.son)->getFather();
+  const Node* father = node->getFather();
+  vector<int> ids;
+  ids.push_back(father->getId());
+  for (size_t i = 0; i < father->getNumberOfSons(); ++i)
+  {
+    ids.push_back(father->getSon(i)->getId());
+  }
+  for (size_t i = 0; i < node->getNumberOfSons(); ++i)
+  {
+    ids.push_back(node->getSon(i)->getId());
+  }
+  return ids;
+}
+
+/******************************************************************************/
+
+double TopologySearchTools::optimizeBranchLengths(
+  TreeTemplate<Node>& tree,
+  const SiteContainer& sites,
+  TransitionModel* model,
+  DiscreteDistribution* rDist,
+  const vector<int>& nodeIds,
+  double tolerance,
+  unsigned int maxEval,
+  vector<double>* patternLogLikelihoods)
+{
+  CountingTreeLikelihood<DRHomogeneousTreeLikelihood> tl(tree, sites, model, rDist, false, false);
+  tl.initialize();
+  ParameterList brLens = tl.getBranchLengthsParameters();
+  ParameterList parameters;
+  if (nodeIds.empty())
+    parameters = brLens;
+  else
+  {
+    // Branch length parameters follow the order of the nodes in the likelihood tree (root excluded):
+    TreeTemplate<Node> tlTree(tl.getTree());
+    vector<int> ids = tlTree.getNodesId();
+    for (size_t i = 0; i < brLens.size(); ++i)
+    {
+      if (find(nodeIds.begin(), nodeIds.end(), ids[i]) != nodeIds.end())
+        parameters.addParameter(brLens[i]);
+    }
+  }
+  OptimizationTools::optimizeNumericalParameters(&tl, parameters, 0, 1, tolerance, maxEval, 0, 0, false, 0);
+  tree = TreeTemplate<Node>(tl.getTree());
+  if (patternLogLikelihoods)
+    *patternLogLikelihoods = getPatternLogLikelihoods_(tl);
+  return -tl.getValue();
+}
+
+/******************************************************************************/
+
+vector<double> TopologySearchTools::getPatternLogLikelihoods(
+  const TreeTemplate<Node>& tree,
+  const SiteContainer& sites,
+  TransitionModel* model,
+  DiscreteDistribution* rDist)
+{
+  CountingTreeLikelihood<DRHomogeneousTreeLikelihood> tl(tree, sites, model, rDist, false, false);
+  tl.initialize();
+  return getPatternLogLikelihoods_(tl);
+}
+
+vector<double> TopologySearchTools::getPatternLogLikelihoods_(const DRHomogeneousTreeLikelihood& tl)
+{
+  const DRASDRTreeLikelihoodData* data = tl.getLikelihoodData();
+  const vector<size_t>& positions = data->getRootArrayPositions();
+  vector<double> siteLogL = tl.getLogLikelihoodForEachSite();
+  vector<double> patternLogL(data->getNumberOfDistinctSites());
+  for (size_t i = 0; i < siteLogL.size(); ++i)
+  {
+    patternLogL[positions[i]] = siteLogL[i];
+  }
+  return patternLogL;
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* TopologySearchTools::optimizeTreeSPR(
+  const Tree& tree,
+  const SiteContainer& sites,
+  const TransitionModel& model,
+  const DiscreteDistribution& rDist,
+  unsigned int radius,
+  unsigned int nbCandidates,
+  unsigned int nbRounds,
+  double tolerance,
+  unsigned int nbThreads,
+  unsigned int verbose)
+{
+  // Models cache their transition probabilities, so each thread needs its own copy:
+  vector< shared_ptr<TransitionModel> > models(nbThreads);
+  vector< shared_ptr<DiscreteDistribution> > rDists(nbThreads);
+  for (unsigned int w = 0; w < nbThreads; ++w)
+  {
+    models[w].reset(model.clone());
+    rDists[w].reset(rDist.clone());
+  }
+
+  unique_ptr< TreeTemplate<Node> > current(new TreeTemplate<Node>(tree));
+  if (current->isRooted())
+    current->unroot();
+  double currentLogL = optimizeBranchLengths(*current, sites, models[0].get(), rDists[0].get(), vector<int>(), tolerance, 1000000);
+  if (verbose)
+    ApplicationTools::displayResult("SPR initial log likelihood", TextTools::toString(currentLogL, 15));
+
+  for (unsigned int round = 0; nbRounds == 0 || round < nbRounds; ++round)
+  {
+    // Lazy scoring, from the conditional likelihoods of the current tree:
+    vector<SPRMove> moves = getSPRMoves(*current, radius);
+    map< pair<int, int>, size_t > moveIndex;
+    vector<int> prunedIds;
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+      moveIndex[make_pair(moves[i].pruned, moves[i].target)] = i;
+      if (prunedIds.empty() || prunedIds.back() != moves[i].pruned)
+        prunedIds.push_back(moves[i].pruned);
+    }
+    if (verbose)
+      ApplicationTools::displayTask("SPR round " + TextTools::toString(round + 1) + ", " + TextTools::toString(moves.size()) + " moves");
+    SPRScorer scorer(*current, sites, *models[0], *rDists[0]);
+    double lazyLogL = scorer.getLogLikelihood(*current, *models[0]);
+    vector<double> scores(moves.size(), -numeric_limits<double>::infinity());
+    vector< vector<int> > touchedNodes(moves.size());
+    ParallelTools::parallelFor(prunedIds.size(), nbThreads, [&](size_t i, unsigned int w) {
+      map<int, double> prunedScores;
+      map<int, vector<int> > prunedTouched;
+      scorer.scoreMoves(current->getNode(prunedIds[i]), radius, *models[w], prunedScores, prunedTouched);
+      for (map<int, double>::const_iterator it = prunedScores.begin(); it != prunedScores.end(); ++it)
+      {
+        map< pair<int, int>, size_t >::const_iterator found = moveIndex.find(make_pair(prunedIds[i], it->first));
+        if (found == moveIndex.end()) continue;
+        scores[found->second] = it->second;
+        touchedNodes[found->second] = prunedTouched[it->first];
+      }
+    });
+    if (verbose)
+      ApplicationTools::displayTaskDone();
+
+    // Keep the best improving moves which do not depend on the same nodes:
+    vector< pair<double, size_t> > sorted;
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+      sorted.push_back(make_pair(scores[i], i));
+    }
+    sort(sorted.begin(), sorted.end(), greater< pair<double, size_t> >());
+    vector<size_t> batch;
+    set<int> touched;
+    for (size_t i = 0; i < sorted.size() && sorted[i].first - lazyLogL >= tolerance; ++i)
+    {
+      const vector<int>& ids = touchedNodes[sorted[i].second];
+      bool conflict = false;
+      for (size_t j = 0; j < ids.size() && !conflict; ++j)
+      {
+        conflict = touched.find(ids[j]) != touched.end();
+      }
+      if (conflict) continue;
+      touched.insert(ids.begin(), ids.end());
+      batch.push_back(sorted[i].second);
+    }
+
+    // Apply the batch, or its best half if the likelihood decreases, and so on:
+    bool improved = false;
+    while (!batch.empty())
+    {
+      unique_ptr< TreeTemplate<Node> > candidate(new TreeTemplate<Node>(*current));
+      for (size_t i = 0; i < batch.size(); ++i)
+      {
+        // Moves of a batch do not share nodes, this is only a safeguard:
+        const SPRMove& move = moves[batch[i]];
+        if (!candidate->hasNode(move.pruned) || !candidate->hasNode(move.target) || !candidate->getNode(move.target)->hasFather())
+          continue;
+        vector<int> modified;
+        candidate.reset(applySPRMove(*candidate, move, modified));
+      }
+      double logL = optimizeBranchLengths(*candidate, sites, models[0].get(), rDists[0].get(), vector<int>(), tolerance, 1000000);
+      if (logL - currentLogL >= tolerance)
+      {
+        if (verbose)
+          ApplicationTools::displayResult("SPR performed", TextTools::toString(batch.size()) + ", log likelihood " + TextTools::toString(logL, 15));
+        current.reset(candidate.release());
+        currentLogL = logL;
+        improved = true;
+        break;
+      }
+      if (batch.size() == 1) break;
+      batch.resize((batch.size() + 1) / 2);
+    }
+
+    // Lazy scores ignore branch lengths changes: the best candidates are also scored after optimizing all of them.
+    if (!improved)
+    {
+      size_t nbScored = min(sorted.size(), static_cast<size_t>(nbCandidates));
+      vector< shared_ptr< TreeTemplate<Node> > > candidates(nbScored);
+      vector<double> candidateLogL(nbScored);
+      ParallelTools::parallelFor(nbScored, nbThreads, [&](size_t i, unsigned int w) {
+        vector<int> modified;
+        candidates[i].reset(applySPRMove(*current, moves[sorted[i].second], modified));
+        candidateLogL[i] = optimizeBranchLengths(*candidates[i], sites, models[w].get(), rDists[w].get(), vector<int>(), tolerance, 1000000);
+      });
+      size_t best = nbScored;
+      double bestLogL = currentLogL;
+      for (size_t i = 0; i < nbScored; ++i)
+      {
+        if (candidateLogL[i] > bestLogL)
+        {
+          bestLogL = candidateLogL[i];
+          best = i;
+        }
+      }
+      if (best < nbScored && bestLogL - currentLogL >= tolerance)
+      {
+        if (verbose)
+          ApplicationTools::displayResult("SPR performed", "1, log likelihood " + TextTools::toString(bestLogL, 15));
+        current.reset(new TreeTemplate<Node>(*candidates[best]));
+        currentLogL = bestLogL;
+        improved = true;
+      }
+    }
+    if (!improved)
+      break;
+  }
+
+  // Finish with an NNI search, which also re-estimates all branch lengths after each round:
+  return optimizeTreeNNI(*current, sites, *models[0], *rDists[0], nbThreads, tolerance, verbose);
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* TopologySearchTools::optimizeTreeNNI(
+  const Tree& tree,
+  const SiteContainer& sites,
+  const TransitionModel& model,
+  const DiscreteDistribution& rDist,
+  unsigned int nbThreads,
+  double tolerance,
+  unsigned int verbose)
+{
+  // Models cache their transition probabilities, so each thread needs its own copy:
+  vector< shared_ptr<TransitionModel> > models(nbThreads);
+  vector< shared_ptr<DiscreteDistribution> > rDists(nbThreads);
+  for (unsigned int w = 0; w < nbThreads; ++w)
+  {
+    models[w].reset(model.clone());
+    rDists[w].reset(rDist.clone());
+  }
+
+  unique_ptr< TreeTemplate<Node> > current(new TreeTemplate<Node>(tree));
+  if (current->isRooted())
+    current->unroot();
+  double currentLogL = optimizeBranchLengths(*current, sites, models[0].get(), rDists[0].get(), vector<int>(), tolerance, 1000000);
+  if (verbose)
+    ApplicationTools::displayResult("NNI initial log likelihood", TextTools::toString(currentLogL, 15));
+
+  while (true)
+  {
+    // Each thread computes the partial likelihoods of the current tree once,
+    // and reuses them to score all the moves it is given:
+    vector< shared_ptr<NNIHomogeneousTreeLikelihood> > workers(nbThreads);
+    ParallelTools::parallelFor(nbThreads, nbThreads, [&](size_t w, unsigned int) {
+      workers[w].reset(new CountingTreeLikelihood<NNIHomogeneousTreeLikelihood>(*current, sites, models[w].get(), rDists[w].get(), false, false));
+      workers[w]->initialize();
+    });
+
+    // Score all moves, only optimizing their central branch. Our moves swap
+    // the son with its uncle, as NNIHomogeneousTreeLikelihood::testNNI does:
+    vector<NNIMove> moves = getNNIMoves(*current);
+    vector<double> scores(moves.size());
+    ParallelTools::parallelFor(moves.size(), nbThreads, [&](size_t i, unsigned int w) {
+      scores[i] = -(workers[w]->getValue() + workers[w]->testNNI(moves[i].son));
+    });
+    workers.clear();
+
+    // Keep the best improving moves which do not share any branch:
+    vector< pair<double, size_t> > improving;
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+      if (scores[i] - currentLogL >= tolerance)
+        improving.push_back(make_pair(scores[i], i));
+    }
+    sort(improving.begin(), improving.end(), greater< pair<double, size_t> >());
+    vector<size_t> batch;
+    set<int> touched;
+    for (size_t i = 0; i < improving.size(); ++i)
+    {
+      vector<int> ids = getNNINeighborhood(*current, moves[improving[i].second]);
+      bool conflict = false;
+      for (size_t j = 0; j < ids.size() && !conflict; ++j)
+      {
+        conflict = touched.find(ids[j]) != touched.end();
+      }
+      if (conflict) continue;
+      touched.insert(ids.begin(), ids.end());
+      batch.push_back(improving[i].second);
+    }
+
+    // Apply the batch, or its best half if the likelihood decreases, and so on:
+    bool improved = false;
+    while (!batch.empty())
+    {
+      unique_ptr< TreeTemplate<Node> > candidate(new TreeTemplate<Node>(*current));
+      for (size_t i = 0; i < batch.size(); ++i)
+      {
+        applyNNIMove(*candidate, moves[batch[i]]);
+      }
+      double logL = optimizeBranchLengths(*candidate, sites, models[0].get(), rDists[0].get(), vector<int>(), tolerance, 1000000);
+      if (logL - currentLogL >= tolerance)
+      {
+        if (verbose)
+          ApplicationTools::displayResult("NNI performed", TextTools::toString(batch.size()) + ", log likelihood " + TextTools::toString(logL, 15));
+        current.reset(candidate.release());
+        currentLogL = logL;
+        improved = true;
+        break;
+      }
+      if (batch.size() == 1) break;
+      batch.resize((batch.size() + 1) / 2);
+    }
+    if (!improved)
+      break;
+  }
+  return current.release();
+}
+
+/******************************************************************************/
+
+map<int, double> TopologySearchTools::computeSHLikeSupports(
+  const TreeTemplate<Node>& tree,
+  const SiteContainer& sites,
+  const TransitionModel& model,
+  const DiscreteDistribution& rDist,
+  unsigned int nbReplicates,
+  unsigned int seed,
+  unsigned int nbThreads,
+  double tolerance)
+{
+  vector< shared_ptr<TransitionModel> > models(nbThreads);
+  vector< shared_ptr<DiscreteDistribution> > rDists(nbThreads);
+  for (unsigned int w = 0; w < nbThreads; ++w)
+  {
+    models[w].reset(model.clone());
+    rDists[w].reset(rDist.clone());
+  }
+
+  // Pattern log-likelihoods and weights of the ML tree:
+  CountingTreeLikelihood<DRHomogeneousTreeLikelihood> tl(tree, sites, models[0].get(), rDists[0].get(), false, false);
+  tl.initialize();
+  vector<double> logL0 = getPatternLogLikelihoods_(tl);
+  vector<unsigned int> weights = tl.getLikelihoodData()->getWeights();
+
+  // The two moves around each branch are consecutive:
+  vector<NNIMove> moves = getNNIMoves(tree);
+  size_t nbBranches = moves.size() / 2;
+  vector<double> supports(nbBranches);
+  ParallelTools::parallelFor(nbBranches, nbThreads, [&](size_t k, unsigned int w) {
+    vector<double> logL[2];
+    for (size_t a = 0; a < 2; ++a)
+    {
+      const NNIMove& move = moves[2 * k + a];
+      TreeTemplate<Node> alternative(tree);
+      applyNNIMove(alternative, move);
+      optimizeBranchLengths(alternative, sites, models[w].get(), rDists[w].get(), getNNINeighborhood(tree, move), tolerance, 100, &logL[a]);
+    }
+    supports[k] = BootstrapTools::computeSHLikeSupport(logL0, logL[0], logL[1], weights, nbReplicates, seed);
+  });
+
+  map<int, double> result;
+  for (size_t k = 0; k < nbBranches; ++k)
+  {
+    result[tree.getNode(moves[2 * k].son)->getFather()->getId()] = supports[k];
+  }
+  return result;
+}
+
+/******************************************************************************/
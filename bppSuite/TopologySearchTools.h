@@ -0,0 +1,328 @@
+//
+// File: TopologySearchTools.h
+// Created by: Bio++ Development Team
+// Created on: Oct Thu 15 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team
+
+   This software is a computer program whose purpose is to estimate
+   phylogenies and evolutionary parameters from a dataset according to
+   the maximum likelihood principle.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BPPSUITE_TOPOLOGYSEARCHTOOLS_H_
+#define _BPPSUITE_TOPOLOGYSEARCHTOOLS_H_
+
+// From the STL:
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// From bpp-core:
+#include <Bpp/Numeric/Prob/DiscreteDistribution.h>
+
+// From bpp-seq:
+#include <Bpp/Seq/Container/SiteContainer.h>
+
+// From bpp-phyl:
+#include <Bpp/Phyl/Tree.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/Model/SubstitutionModel.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+
+namespace bpp
+{
+/**
+ * @brief A subtree prune and regraft move.
+ *
+ * The subtree below node 'pruned' is detached from its father, and
+ * reattached on the branch above node 'target'.
+ */
+struct SPRMove
+{
+  int pruned;
+  int target;
+
+  SPRMove(int p, int t) : pruned(p), target(t) {}
+};
+
+/**
+ * @brief A nearest neighbor interchange.
+ *
+ * The subtree below node 'son' is swapped with the subtree below node
+ * 'sibling', which is a son of the father of the father of 'son'. The
+ * branch above the father of 'son' is the central branch of the move.
+ */
+struct NNIMove
+{
+  int son;
+  int sibling;
+
+  NNIMove(int s, int b) : son(s), sibling(b) {}
+};
+
+/**
+ * @brief Tree search algorithms which are not provided by the likelihood classes.
+ *
+ * Candidate topologies are scored on their own likelihood object, with
+ * the substitution model and rate distribution parameters kept fixed.
+ */
+class TopologySearchTools
+{
+public:
+  /**
+   * @brief Build a random rooted binary tree, without branch lengths.
+   *
+   * This is TreeTemplateTools::getRandomTree, drawing from the given
+   * generator instead of the global one, so that trees can be built
+   * concurrently and reproducibly.
+   *
+   * @param leavesNames The names of the leaves.
+   * @param generator   The random generator to use.
+   * @return A new tree.
+   */
+  static TreeTemplate<Node>* getRandomTree(const std::vector<std::string>& leavesNames, std::mt19937& generator);
+
+  /**
+   * @brief List all SPR moves within a given distance of the pruning point.
+   *
+   * The radius is the maximum number of branches between the branch where the
+   * subtree is removed and the branch where it is reinserted. A radius of 1
+   * corresponds to NNI-like moves. Moves giving back the input tree are
+   * excluded.
+   *
+   * @param tree   An unrooted tree.
+   * @param radius The maximum regrafting distance.
+   * @return The list of moves.
+   */
+  static std::vector<SPRMove> getSPRMoves(const TreeTemplate<Node>& tree, unsigned int radius);
+
+  /**
+   * @brief Apply a SPR move.
+   *
+   * The branch where the subtree is reinserted is split in two halves.
+   *
+   * @param tree     An unrooted tree.
+   * @param move     The move to perform.
+   * @param modified [out] The ids of the nodes above the branches created or modified at the insertion point.
+   * @return A new, unrooted, tree.
+   */
+  static TreeTemplate<Node>* applySPRMove(const TreeTemplate<Node>& tree, const SPRMove& move, std::vector<int>& modified);
+
+  /**
+   * @brief List the two NNI moves around each internal branch.
+   *
+   * Branches with a multifurcating node below them are skipped.
+   *
+   * @param tree An unrooted tree.
+   * @return The list of moves.
+   */
+  static std::vector<NNIMove> getNNIMoves(const TreeTemplate<Node>& tree);
+
+  /**
+   * @brief Apply a NNI move, in place.
+   *
+   * Branch lengths are kept with the swapped subtrees.
+   *
+   * @param tree An unrooted tree.
+   * @param move The move to perform.
+   */
+  static void applyNNIMove(TreeTemplate<Node>& tree, const NNIMove& move);
+
+  /**
+   * @brief Get the ids of the nodes whose branches are modified by, or adjacent to, a NNI move.
+   *
+   * Two moves whose neighborhoods do not intersect can be applied together.
+   *
+   * @param tree An unrooted tree.
+   * @param move The move to perform.
+   * @return The list of node ids.
+   */
+  static std::vector<int> getNNINeighborhood(const TreeTemplate<Node>& tree, const NNIMove& move);
+
+  /**
+   * @brief Optimize (some of) the branch lengths of a tree, all other parameters being fixed.
+   *
+   * @param tree      The tree, which will be updated with the estimated branch lengths.
+   * @param sites     The alignment.
+   * @param model     The substitution model.
+   * @param rDist     The rate distribution.
+   * @param nodeIds   The ids of the nodes above the branches to optimize, or empty for all branches.
+   * @param tolerance The tolerance of the optimization.
+   * @param maxEval   The maximum number of likelihood evaluations.
+   * @param patternLogLikelihoods [out] If not null, the log-likelihood of each distinct site pattern, see getPatternLogLikelihoods.
+   * @return The log-likelihood of the tree.
+   */
+  static double optimizeBranchLengths(
+    TreeTemplate<Node>& tree,
+    const SiteContainer& sites,
+    TransitionModel* model,
+    DiscreteDistribution* rDist,
+    const std::vector<int>& nodeIds,
+    double tolerance,
+    unsigned int maxEval,
+    std::vector<double>* patternLogLikelihoods = 0);
+
+  /**
+   * @brief Compute the log-likelihood of each distinct site pattern for a given tree, all parameters being fixed.
+   *
+   * Patterns are in the order of the compressed data of a DRHomogeneousTreeLikelihood
+   * built on the same alignment, which does not depend on the tree. The weights
+   * of the patterns are given by DRASDRTreeLikelihoodData::getWeights().
+   *
+   * @param tree  The tree.
+   * @param sites The alignment.
+   * @param model The substitution model.
+   * @param rDist The rate distribution.
+   * @return The log-likelihood of each distinct site pattern.
+   */
+  static std::vector<double> getPatternLogLikelihoods(
+    const TreeTemplate<Node>& tree,
+    const SiteContainer& sites,
+    TransitionModel* model,
+    DiscreteDistribution* rDist);
+
+  /**
+   * @brief Search the tree topology with SPR moves.
+   *
+   * At each round, all moves within the radius are scored from the
+   * conditional likelihoods of the current tree, computed once: for each
+   * pruned subtree, the likelihood arrays are updated one branch at a time
+   * while walking away from the pruning point, with branch lengths kept
+   * fixed. The best improving moves which do not depend on the same nodes
+   * are applied together, and all branch lengths are re-estimated. If the
+   * likelihood decreases, only the best half of the moves is applied, and
+   * so on. If no move is left, the best candidates are scored again after
+   * optimizing all branch lengths, and the best of them is kept if it
+   * improves the likelihood.
+   *
+   * The search stops when no move improves the likelihood, or after the
+   * maximum number of rounds, and is followed by an NNI search
+   * (see optimizeTreeNNI).
+   *
+   * Subtrees are scored concurrently, each thread with its own copy of the
+   * model and rate distribution.
+   *
+   * @param tree         The starting tree.
+   * @param sites        The alignment.
+   * @param model        The substitution model.
+   * @param rDist        The rate distribution.
+   * @param radius       The maximum regrafting distance.
+   * @param nbCandidates The number of candidates fully optimized at each round.
+   * @param nbRounds     The maximum number of rounds, 0 for no limit.
+   * @param tolerance    The minimum log-likelihood improvement, also used for branch length estimation.
+   * @param nbThreads    The number of threads to use.
+   * @param verbose      Verbose level.
+   * @return A new tree, with the best topology found and its branch lengths.
+   */
+  static TreeTemplate<Node>* optimizeTreeSPR(
+    const Tree& tree,
+    const SiteContainer& sites,
+    const TransitionModel& model,
+    const DiscreteDistribution& rDist,
+    unsigned int radius,
+    unsigned int nbCandidates,
+    unsigned int nbRounds,
+    double tolerance,
+    unsigned int nbThreads = 1,
+    unsigned int verbose = 1);
+
+  /**
+   * @brief Search the tree topology with NNI moves, scoring the candidates concurrently.
+   *
+   * This follows the 'phyml' strategy: at each round, all NNIs are scored
+   * by optimizing their central branch, the improving ones which do not
+   * share any branch are applied together, and all branch lengths are
+   * re-estimated. If the likelihood decreases, only the best half of the
+   * moves is applied, and so on. The search stops when no NNI improves
+   * the likelihood.
+   *
+   * Each thread scores its candidates on its own likelihood object, with
+   * its own copy of the model and rate distribution. This object is built
+   * once per round on the current tree, and a move is scored from its
+   * partial likelihoods by re-estimating the length of the branch above
+   * the father of the moved node only, so that no likelihood is recomputed
+   * on the whole tree for each candidate.
+   *
+   * @param tree      The starting tree.
+   * @param sites     The alignment.
+   * @param model     The substitution model.
+   * @param rDist     The rate distribution.
+   * @param nbThreads The number of threads to use.
+   * @param tolerance The minimum log-likelihood improvement, also used for branch length estimation.
+   * @param verbose   Verbose level.
+   * @return A new tree, with the best topology found and its branch lengths.
+   */
+  static TreeTemplate<Node>* optimizeTreeNNI(
+    const Tree& tree,
+    const SiteContainer& sites,
+    const TransitionModel& model,
+    const DiscreteDistribution& rDist,
+    unsigned int nbThreads,
+    double tolerance,
+    unsigned int verbose = 1);
+
+  /**
+   * @brief Compute the SH-like aLRT support of all internal branches.
+   *
+   * For each internal branch, the two NNI alternatives are built, and their
+   * central and four adjacent branches are optimized. The support is then
+   * computed from the pattern log-likelihoods of the three trees, see
+   * BootstrapTools::computeSHLikeSupport. Branches are processed concurrently,
+   * each thread having its own copy of the model and rate distribution.
+   *
+   * @param tree         The ML tree, unrooted.
+   * @param sites        The alignment.
+   * @param model        The substitution model.
+   * @param rDist        The rate distribution.
+   * @param nbReplicates The number of RELL replicates.
+   * @param seed         The base seed of the replicates.
+   * @param nbThreads    The number of threads to use.
+   * @param tolerance    The tolerance used for branch length estimation.
+   * @return The support of each internal branch, between 0 and 1, indexed by the id of the node below it.
+   */
+  static std::map<int, double> computeSHLikeSupports(
+    const TreeTemplate<Node>& tree,
+    const SiteContainer& sites,
+    const TransitionModel& model,
+    const DiscreteDistribution& rDist,
+    unsigned int nbReplicates,
+    unsigned int seed,
+    unsigned int nbThreads,
+    double tolerance);
+
+private:
+  static std::vector<double> getPatternLogLikelihoods_(const DRHomogeneousTreeLikelihood& tl);
+};
+} // end of namespace bpp.
+
+#endif // _BPPSUITE_TOPOLOGYSEARCHTOOLS_H_
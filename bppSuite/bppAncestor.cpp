@@ -83,6 +83,9 @@ using namespace std;
 #include <Bpp/Phyl/Model/RateDistribution/ConstantRateDistribution.h>
 #include <Bpp/Phyl/Io/Newick.h>
 
+// From bppsuite:
+#include "AlignmentCache.h"
+
 using namespace bpp;
 
 /******************************************************************************/
@@ -127,10 +130,7 @@ int main(int args, char ** argv)
     gCode.reset(SequenceApplicationTools::getGeneticCode(codonAlphabet->getNucleicAlphabet(), codeDesc));
   }
 
-  VectorSiteContainer* allSites = SequenceApplicationTools::getSiteContainer(alphabet, bppancestor.getParams());
-  
-  VectorSiteContainer* sites = SequenceApplicationTools::getSitesToAnalyse(* allSites, bppancestor.getParams(), "", true, false);
-  delete allSites;
+  VectorSiteContainer* sites = AlignmentCache::getSitesToAnalyse(alphabet, bppancestor.getParams(), "", true, false);
 
   ApplicationTools::displayResult("Number of sequences", TextTools::toString(sites->getNumberOfSequences()));
   ApplicationTools::displayResult("Number of sites", TextTools::toString(sites->getNumberOfSites()));
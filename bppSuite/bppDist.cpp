@@ -77,6 +77,10 @@ using namespace std;
 #include <Bpp/Phyl/Model/MarkovModulatedSubstitutionModel.h>
 #include <Bpp/Phyl/Model/RateDistribution/ConstantRateDistribution.h>
 
+// From bppsuite:
+#include "BootstrapTools.h"
+#include "SiteFilterTools.h"
+
 using namespace bpp;
 
 void help()
@@ -109,6 +113,13 @@ int main(int args, char ** argv)
   BppApplication bppdist(args, argv, "BppDist");
   bppdist.startTimer();
 
+  // Merge the replicates of a sharded bootstrap analysis:
+  if (BootstrapTools::mergeShards(bppdist.getParams()))
+  {
+    bppdist.done();
+    return 0;
+  }
+
   Alphabet* alphabet = SequenceApplicationTools::getAlphabet(bppdist.getParams(), "", false);
   unique_ptr<GeneticCode> gCode;
   CodonAlphabet* codonAlphabet = dynamic_cast<CodonAlphabet*>(alphabet);
@@ -119,10 +130,8 @@ int main(int args, char ** argv)
     gCode.reset(SequenceApplicationTools::getGeneticCode(codonAlphabet->getNucleicAlphabet(), codeDesc));
   }
 
-  VectorSiteContainer* allSites = SequenceApplicationTools::getSiteContainer(alphabet, bppdist.getParams());
   
-  VectorSiteContainer* sites = SequenceApplicationTools::getSitesToAnalyse(* allSites, bppdist.getParams());
-  delete allSites;
+  VectorSiteContainer* sites = SiteFilterTools::getSitesToAnalyse(alphabet, bppdist.getParams());
 
   ApplicationTools::displayResult("Number of sequences", TextTools::toString(sites->getNumberOfSequences()));
   ApplicationTools::displayResult("Number of sites", TextTools::toString(sites->getNumberOfSites()));
@@ -317,6 +326,10 @@ int main(int args, char ** argv)
       ignoreBrLen = true;
     }
     bool bootstrapVerbose = ApplicationTools::getBooleanParameter("bootstrap.verbose", bppdist.getParams(), false, "", true, false);
+    unsigned int bsSeed = BootstrapTools::getSeed(bppdist.getParams(), 2);
+    ApplicationTools::displayResult("Bootstrap seed", bsSeed);
+    size_t bsBegin, bsEnd;
+    bool sharded = BootstrapTools::getShard(bppdist.getParams(), nbBS, bsBegin, bsEnd, 2);
  
     string bsTreesPath = ApplicationTools::getAFilePath("bootstrap.output.file", bppdist.getParams(), false, false);
     ofstream *out = NULL;
@@ -325,14 +338,21 @@ int main(int args, char ** argv)
       ApplicationTools::displayResult("Bootstrap trees stored in file", bsTreesPath);
       out = new ofstream(bsTreesPath.c_str(), ios::out);
     }
+    else if(sharded)
+      throw Exception("'bootstrap.output.file' must be set when replicates are sharded.");
     Newick newick;
     
-    vector<Tree *> bsTrees(nbBS);
+    // Each replicate starts from the estimates on the original data, so that it does not depend on the previous ones:
+    ParameterList modelParameters = model->getParameters();
+    ParameterList rDistParameters = rDist->getParameters();
+    vector<Tree *> bsTrees(nbBS, 0);
     ApplicationTools::displayTask("Bootstrapping", true);
-    for(unsigned int i = 0; i < nbBS; i++)
+    for(size_t i = bsBegin; i < bsEnd; i++)
     {
-      ApplicationTools::displayGauge(i, nbBS-1, '=');
-      VectorSiteContainer * sample = SiteContainerTools::bootstrapSites(*sites);
+      ApplicationTools::displayGauge(i - bsBegin + 1, bsEnd - bsBegin, '=');
+      model->matchParametersValues(modelParameters);
+      rDist->matchParametersValues(rDistParameters);
+      VectorSiteContainer * sample = BootstrapTools::bootstrapSites(*sites, bsSeed, i);
       if(approx) model->setFreqFromData(*sample);
       distEstimation.setData(sample);
       bsTrees[i] = OptimizationTools::buildDistanceTree(
@@ -347,20 +367,27 @@ int main(int args, char ** argv)
           NULL,
           (bootstrapVerbose ? 1 : 0)
         );
-      if(out && i == 0) newick.write(*bsTrees[i], bsTreesPath, true);
-      if(out && i >  0) newick.write(*bsTrees[i], bsTreesPath, false);
+      if(out) newick.write(*bsTrees[i], bsTreesPath, i == bsBegin);
       delete sample;
     }
     if(out) out->close();
     if(out) delete out;
     ApplicationTools::displayTaskDone();
-    ApplicationTools::displayTask("Compute bootstrap values");
-    TreeTools::computeBootstrapValues(*tree, bsTrees);
-    ApplicationTools::displayTaskDone();
-    for(unsigned int i = 0; i < nbBS; i++) delete bsTrees[i];
+    if(sharded)
+    {
+      //Bootstrap values are computed when merging all shards:
+      ApplicationTools::displayMessage("Shard done. Use 'bootstrap.merge' to compute bootstrap values.");
+    }
+    else
+    {
+      ApplicationTools::displayTask("Compute bootstrap values");
+      TreeTools::computeBootstrapValues(*tree, bsTrees);
+      ApplicationTools::displayTaskDone();
 
-    //Write resulting tree:
-    PhylogeneticsApplicationTools::writeTree(*tree, bppdist.getParams());
+      //Write resulting tree:
+      PhylogeneticsApplicationTools::writeTree(*tree, bppdist.getParams());
+    }
+    for(unsigned int i = 0; i < nbBS; i++) delete bsTrees[i];
   }
     
   delete alphabet;
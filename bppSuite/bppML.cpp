@@ -39,9 +39,16 @@
  */
 
 // From the STL:
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
 
 using namespace std;
 
@@ -53,6 +60,8 @@ using namespace std;
 #include <Bpp/Numeric/Matrix/MatrixTools.h>
 #include <Bpp/Numeric/VectorTools.h>
 #include <Bpp/Numeric/AutoParameter.h>
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
 #include <Bpp/App/BppApplication.h>
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Io/FileTools.h>
@@ -68,6 +77,7 @@ using namespace std;
 
 // From bpp-phyl:
 #include <Bpp/Phyl/Tree.h>
+#include <Bpp/Phyl/TreeTools.h>
 #include <Bpp/Phyl/Likelihood/RHomogeneousMixedTreeLikelihood.h>
 #include <Bpp/Phyl/Likelihood/DRHomogeneousMixedTreeLikelihood.h>
 #include <Bpp/Phyl/Likelihood/RNonHomogeneousMixedTreeLikelihood.h>
@@ -76,6 +86,7 @@ using namespace std;
 #include <Bpp/Phyl/PatternTools.h>
 #include <Bpp/Phyl/App/PhylogeneticsApplicationTools.h>
 #include <Bpp/Phyl/OptimizationTools.h>
+#include <Bpp/Phyl/Parsimony/DRTreeParsimonyScore.h>
 #include <Bpp/Phyl/Model/SubstitutionModelSetTools.h>
 #include <Bpp/Phyl/Model/MixedSubstitutionModel.h>
 #include <Bpp/Phyl/Model/Protein/CoalaCore.h>
@@ -83,6 +94,17 @@ using namespace std;
 #include <Bpp/Phyl/Model/FrequenciesSet/MvaFrequenciesSet.h>
 #include <Bpp/Phyl/Io/Newick.h>
 
+// From bppsuite:
+#include "AlignmentCache.h"
+#include "BootstrapTools.h"
+#include "Checkpoint.h"
+#include "LikelihoodMemoryTools.h"
+#include "PerformanceMonitor.h"
+#include "SiteFilterTools.h"
+#include "TopologySearchTools.h"
+#include "ParallelTools.h"
+#include "PartitionedTreeLikelihood.h"
+
 using namespace bpp;
 
 /******************************************************************************/
@@ -97,6 +119,421 @@ void help()
   (*ApplicationTools::message << "__________________________________________________________________________").endLine();
 }
 
+/******************************************************************************/
+
+/**
+ * @brief Estimate parameters like PhylogeneticsApplicationTools::optimizeParameters,
+ * but with the concurrent NNI search of TopologySearchTools.
+ *
+ * Numerical parameters and the topology are estimated in turn, until the
+ * topology does not change anymore, or the log-likelihood does not improve
+ * by more than the tolerance. The input likelihood object is deleted.
+ */
+NNIHomogeneousTreeLikelihood* optimizeParametersWithConcurrentNNI(
+  DiscreteRatesAcrossSitesTreeLikelihood* tl,
+  const ParameterList& parameters,
+  const SiteContainer& sites,
+  TransitionModel* model,
+  DiscreteDistribution* rDist,
+  map<string, string> params,
+  unsigned int nbThreads,
+  bool checkTree)
+{
+  params["optimization.topology"] = "no";
+  tl = dynamic_cast<DiscreteRatesAcrossSitesTreeLikelihood*>(
+    PhylogeneticsApplicationTools::optimizeParameters(tl, parameters, params, "", true, false));
+  double tolerance = ApplicationTools::getDoubleParameter("optimization.tolerance", params, .000001, "", true, 3);
+  unsigned int verbose = ApplicationTools::getParameter<unsigned int>("optimization.verbose", params, 2, "", true, 3);
+  while (true)
+  {
+    double previousLogL = -tl->getValue();
+    unique_ptr< TreeTemplate<Node> > nniTree(TopologySearchTools::optimizeTreeNNI(
+      tl->getTree(), sites, *model, *rDist, nbThreads, tolerance, verbose));
+    bool changed = !TreeTools::haveSameTopology(tl->getTree(), *nniTree);
+    // NNI moves keep node ids, so the branch length parameters have the same names:
+    NNIHomogeneousTreeLikelihood* nniTl = new CountingTreeLikelihood<NNIHomogeneousTreeLikelihood>(*nniTree, sites, model, rDist, checkTree, false);
+    nniTl->initialize();
+    delete tl;
+    tl = dynamic_cast<DiscreteRatesAcrossSitesTreeLikelihood*>(
+      PhylogeneticsApplicationTools::optimizeParameters(nniTl, nniTl->getParameters().subList(parameters.getParameterNames()), params, "", true, false));
+    if (!changed || -tl->getValue() - previousLogL < tolerance)
+      break;
+  }
+  return dynamic_cast<NNIHomogeneousTreeLikelihood*>(tl);
+}
+
+/******************************************************************************/
+
+/**
+ * @brief Analyse a list of alignments in a single process.
+ *
+ * Each line of the list contains the path of an alignment, optionally
+ * followed by the path of a tree for this alignment. The options, the
+ * model and the rate distribution are parsed once and copied for each
+ * alignment. Alignments are processed concurrently, the biggest files
+ * first, each thread taking the next alignment as soon as it is done
+ * with the previous one.
+ */
+void runBatch(BppApplication& bppml, const Alphabet* alphabet, const GeneticCode* gCode, const string& listPath)
+{
+  struct Job
+  {
+    string name;
+    string alignment;
+    string tree;
+    streamoff size;
+  };
+
+  // Read the list of alignments:
+  vector<Job> jobs;
+  ifstream list(listPath.c_str(), ios::in);
+  string line;
+  while (getline(list, line))
+  {
+    line = TextTools::removeSurroundingWhiteSpaces(line);
+    if (line.empty() || line[0] == '#') continue;
+    istringstream fields(line);
+    Job job;
+    fields >> job.alignment >> job.tree;
+    size_t begin = job.alignment.find_last_of("/\\");
+    job.name = job.alignment.substr(begin == string::npos ? 0 : begin + 1);
+    job.name = job.name.substr(0, job.name.find_last_of('.'));
+    ifstream alignmentFile(job.alignment.c_str(), ios::in | ios::binary | ios::ate);
+    if (!alignmentFile)
+      throw Exception("Alignment file not found: " + job.alignment);
+    job.size = alignmentFile.tellg();
+    jobs.push_back(job);
+  }
+  list.close();
+  if (jobs.empty())
+    throw Exception("No alignment found in " + listPath);
+  ApplicationTools::displayResult("Number of alignments", jobs.size());
+
+  string nhOpt = ApplicationTools::getStringParameter("nonhomogeneous", bppml.getParams(), "no", "", true, 1);
+  if (nhOpt != "no")
+    throw Exception("Batch mode is only available for homogeneous models.");
+  string initTreeOpt = ApplicationTools::getStringParameter("init.tree", bppml.getParams(), "user", "", false, 1);
+  bool checkTree = ApplicationTools::getBooleanParameter("input.tree.check_root", bppml.getParams(), true, "", true, 2);
+  bool optimizeTopo = ApplicationTools::getBooleanParameter("optimization.topology", bppml.getParams(), false, "", true, 1);
+  unsigned int nbThreads = ParallelTools::getNumberOfThreads("input.sequence.list.threads", bppml.getParams(), 1);
+  ApplicationTools::displayResult("Number of threads", nbThreads);
+  string resultsPath = ApplicationTools::getAFilePath("output.batch.file", bppml.getParams(), true, false);
+  ApplicationTools::displayResult("Results written to", resultsPath);
+  string outputDir = ApplicationTools::getStringParameter("output.batch.dir", bppml.getParams(), "none", "", true, 1);
+  ApplicationTools::displayResult("Per-alignment outputs written to", outputDir);
+
+  // The model and rate distribution are built once, from the first alignment,
+  // and copied for each job. Observed frequencies are recomputed for each alignment.
+  unique_ptr<TransitionModel> modelTemplate;
+  unique_ptr<DiscreteDistribution> rDistTemplate;
+  {
+    map<string, string> params = bppml.getParams();
+    params["input.sequence.file"] = jobs[0].alignment;
+    unique_ptr<VectorSiteContainer> sites(SiteFilterTools::getSitesToAnalyse(alphabet, params, "", true, false, false));
+    modelTemplate.reset(PhylogeneticsApplicationTools::getTransitionModel(alphabet, gCode, sites.get(), params));
+    if (dynamic_cast<MixedSubstitutionModel*>(modelTemplate.get()))
+      throw Exception("Batch mode is not available for mixed models.");
+    if (modelTemplate->getNumberOfStates() >= 2 * modelTemplate->getAlphabet()->getSize())
+      rDistTemplate.reset(new ConstantRateDistribution());
+    else
+      rDistTemplate.reset(PhylogeneticsApplicationTools::getRateDistribution(params));
+  }
+  bool observedFreqs = ApplicationTools::getStringParameter("model", bppml.getParams(), "", "", true, 3).find("observed") != string::npos;
+  vector<string> parameterNames = modelTemplate->getParameters().getParameterNames();
+  VectorTools::append(parameterNames, rDistTemplate->getParameters().getParameterNames());
+
+  vector<string> colNames;
+  colNames.push_back("Name");
+  colNames.push_back("Alignment");
+  colNames.push_back("Sequences");
+  colNames.push_back("Sites");
+  colNames.push_back("LogL");
+  VectorTools::append(colNames, parameterNames);
+  colNames.push_back("Error");
+  vector< vector<string> > rows(jobs.size(), vector<string>(colNames.size(), "NA"));
+
+  // Biggest alignments first, for a better load balance:
+  vector<size_t> order(jobs.size());
+  for (size_t i = 0; i < jobs.size(); ++i)
+  {
+    order[i] = i;
+  }
+  stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return jobs[a].size > jobs[b].size; });
+
+  // Random trees are drawn from a generator dedicated to each alignment, as the global one cannot be shared by threads:
+  unsigned int treeSeed = 0;
+  if (initTreeOpt == "random")
+    treeSeed = RandomTools::giveIntRandomNumberBetweenZeroAndEntry<unsigned int>(numeric_limits<unsigned int>::max());
+
+  map<string, string> jobParams = bppml.getParams();
+  jobParams["optimization.verbose"] = "0";
+  jobParams["optimization.message_handler"] = "none";
+  jobParams["optimization.profiler"] = "none";
+  jobParams["optimization.backup.file"] = "none";
+
+  // Messages from the jobs would be interleaved, only a summary is written for each of them:
+  auto message = ApplicationTools::message;
+  auto warning = ApplicationTools::warning;
+  ApplicationTools::message = 0;
+  ApplicationTools::warning = 0;
+  mutex batchMutex;
+  size_t nbDone = 0;
+  size_t nbFailed = 0;
+  ParallelTools::parallelFor(jobs.size(), nbThreads, [&](size_t k, unsigned int) {
+    const Job& job = jobs[order[k]];
+    vector<string>& row = rows[order[k]];
+    row[0] = job.name;
+    row[1] = job.alignment;
+    try
+    {
+      map<string, string> params = jobParams;
+      params["input.sequence.file"] = job.alignment;
+      unique_ptr<VectorSiteContainer> sites(SiteFilterTools::getSitesToAnalyse(alphabet, params, "", true, false, false));
+      row[2] = TextTools::toString(sites->getNumberOfSequences());
+      row[3] = TextTools::toString(sites->getNumberOfSites());
+
+      unique_ptr<Tree> tree;
+      if (!job.tree.empty())
+      {
+        params["input.tree.file"] = job.tree;
+        tree.reset(PhylogeneticsApplicationTools::getTree(params, "input.", "", true, false));
+      }
+      else if (initTreeOpt == "random")
+      {
+        mt19937 generator = BootstrapTools::getGenerator(treeSeed, order[k]);
+        tree.reset(TopologySearchTools::getRandomTree(sites->getSequencesNames(), generator));
+        tree->setBranchLengths(1.);
+      }
+      else
+        tree.reset(PhylogeneticsApplicationTools::getTree(params, "input.", "", true, false));
+
+      unique_ptr<TransitionModel> model(modelTemplate->clone());
+      unique_ptr<DiscreteDistribution> rDist(rDistTemplate->clone());
+      if (observedFreqs)
+        model->setFreqFromData(*sites);
+      if (model->getName() != "RE08") SiteContainerTools::changeGapsToUnknownCharacters(*sites);
+
+      unique_ptr<DiscreteRatesAcrossSitesTreeLikelihood> tl;
+      if (optimizeTopo)
+        tl.reset(new CountingTreeLikelihood<NNIHomogeneousTreeLikelihood>(*tree, *sites, model.get(), rDist.get(), checkTree, false));
+      else
+        tl.reset(new CountingTreeLikelihood<RHomogeneousTreeLikelihood>(*tree, *sites, model.get(), rDist.get(), checkTree, false, true));
+      tl->initialize();
+      // The optimizer may return a new likelihood object, in place of the one it was given:
+      TreeLikelihood* optimized = PhylogeneticsApplicationTools::optimizeParameters(tl.get(), tl->getParameters(), params, "", true, false);
+      if (!optimized)
+        throw Exception("Parameter optimization failed.");
+      if (optimized != tl.get())
+      {
+        tl.release();
+        tl.reset(dynamic_cast<DiscreteRatesAcrossSitesTreeLikelihood*>(optimized));
+      }
+      double logL = -tl->getValue();
+      row[4] = TextTools::toString(logL, 15);
+      ParameterList parameters = model->getParameters();
+      parameters.addParameters(rDist->getParameters());
+      for (size_t i = 0; i < parameterNames.size(); ++i)
+      {
+        row[5 + i] = TextTools::toString(parameters.getParameter(parameterNames[i]).getValue());
+      }
+
+      if (outputDir != "none")
+      {
+        string prefix = outputDir + "/" + job.name;
+        Newick newick;
+        newick.write(tl->getTree(), prefix + ".dnd", true);
+        StlOutputStream out(new ofstream((prefix + ".params").c_str(), ios::out));
+        out << "# Log likelihood = ";
+        out.setPrecision(20) << logL;
+        out.endLine();
+        PhylogeneticsApplicationTools::printParameters(model.get(), out, 1, true);
+        PhylogeneticsApplicationTools::printParameters(rDist.get(), out, true);
+      }
+    }
+    catch (exception& e)
+    {
+      string error = e.what();
+      replace(error.begin(), error.end(), '\t', ' ');
+      replace(error.begin(), error.end(), '\n', ' ');
+      row.back() = error;
+      lock_guard<mutex> lock(batchMutex);
+      nbFailed++;
+    }
+    lock_guard<mutex> lock(batchMutex);
+    nbDone++;
+    if (message)
+      (*message << "[" << nbDone << "/" << jobs.size() << "] " << job.name << ": " << (row.back() == "NA" ? row[4] : "failed")).endLine();
+  });
+  ApplicationTools::message = message;
+  ApplicationTools::warning = warning;
+  ApplicationTools::displayResult("Number of failed alignments", nbFailed);
+
+  DataTable results(colNames);
+  for (size_t i = 0; i < rows.size(); ++i)
+  {
+    results.addRow(rows[i]);
+  }
+  ofstream out(resultsPath.c_str(), ios::out);
+  DataTable::write(results, out, "\t");
+}
+
+/******************************************************************************/
+
+/**
+ * @brief Add a suffix to the model and rate distribution options written by printParameters,
+ * so that the estimates of each partition can be read back as options.
+ */
+string addOptionSuffix(const string& options, const string& suffix)
+{
+  istringstream in(options);
+  ostringstream out;
+  string line;
+  while (getline(in, line))
+  {
+    string::size_type equalPos = line.find('=');
+    if (equalPos != string::npos && (line.compare(0, 5, "model") == 0 || line.compare(0, 17, "rate_distribution") == 0))
+    {
+      string::size_type nameEnd = line.find_last_not_of(" ", equalPos - 1) + 1;
+      line.insert(nameEnd, suffix);
+    }
+    out << line << endl;
+  }
+  return out.str();
+}
+
+/******************************************************************************/
+
+/**
+ * @brief Estimate one model per partition of the alignment, on a common tree (input.partition.file).
+ */
+void runPartitioned(BppApplication& bppml, const Alphabet* alphabet, const GeneticCode* gCode, const SiteContainer& sites, const Tree& tree, const string& partitionPath)
+{
+  // Only the numerical parameters are estimated, on the input tree:
+  map<string, string>& params = bppml.getParams();
+  if (ApplicationTools::getBooleanParameter("optimization.topology", params, false, "", true, 3))
+    throw Exception("Topology estimation is not supported with partitions (input.partition.file).");
+  if (ApplicationTools::getParameter<unsigned int>("bootstrap.number", params, 0, "", true, 3) > 0)
+    throw Exception("Bootstrap analyses are not supported with partitions (input.partition.file).");
+  if (ApplicationTools::getStringParameter("support.method", params, "none", "", true, 3) != "none")
+    throw Exception("Branch supports are not supported with partitions (input.partition.file).");
+  if (ApplicationTools::getParameter<unsigned int>("init.tree.number", params, 1, "", true, 3) > 1)
+    throw Exception("Multiple starting trees are not supported with partitions (input.partition.file).");
+  if (ApplicationTools::getStringParameter("optimization.checkpoint.file", params, "none", "", true, 3) != "none")
+    throw Exception("Checkpoints are not supported with partitions (input.partition.file).");
+  if (ApplicationTools::getStringParameter("nonhomogeneous", params, "no", "", true, 3) != "no")
+    throw Exception("Non-homogeneous models are not supported with partitions (input.partition.file).");
+  if (ApplicationTools::getStringParameter("optimization.ignore_parameters", params, "", "", true, 3) != "")
+    throw Exception("Ignored parameters are not supported with partitions (input.partition.file).");
+  if (ApplicationTools::getStringParameter("optimization.constrained_parameters", params, "", "", true, 3) != "")
+    throw Exception("Constrained parameters are not supported with partitions (input.partition.file).");
+  if (ApplicationTools::getStringParameter("optimization.clock", params, "None", "", true, 3) != "None")
+    throw Exception("Molecular clock is not supported with partitions (input.partition.file).");
+  // Partitions always use the double recursion:
+  if (ApplicationTools::getStringParameter("likelihood.recursion", params, "double", "", true, 3) != "double")
+    throw Exception("Only the double recursion is supported with partitions (input.partition.file).");
+
+  vector<Partition> partitions = PartitionedTreeLikelihood::readPartitions(partitionPath, sites);
+  ApplicationTools::displayResult("Number of partitions", partitions.size());
+  string brLenLink = ApplicationTools::getStringParameter("partition.branch_lengths", bppml.getParams(), "proportional", "", true, 1);
+  if (brLenLink != "shared" && brLenLink != "proportional")
+    throw Exception("Unknown branch length link between partitions: " + brLenLink);
+  ApplicationTools::displayResult("Branch lengths of partitions", brLenLink);
+  unsigned int nbThreads = ParallelTools::getNumberOfThreads("partition.threads", bppml.getParams(), 1);
+  ApplicationTools::displayResult("Number of partition threads", nbThreads);
+
+  // Options of each partition are read with the partition name as a suffix, e.g. model.gene1,
+  // and default to the options without suffix:
+  vector<TransitionModel*> models;
+  vector<DiscreteDistribution*> rDists;
+  for (size_t i = 0; i < partitions.size(); i++)
+  {
+    string suffix = "." + partitions[i].name;
+    ApplicationTools::displayResult("Partition", partitions[i].name + " (" + TextTools::toString(partitions[i].sites.size()) + " sites)");
+    unique_ptr<SiteContainer> partitionSites(SiteContainerTools::getSelectedSites(sites, partitions[i].sites));
+    TransitionModel* model = PhylogeneticsApplicationTools::getTransitionModel(alphabet, gCode, partitionSites.get(), bppml.getParams(), suffix, true);
+    models.push_back(model);
+    if (dynamic_cast<MixedSubstitutionModel*>(model))
+      throw Exception("Partitioned analyses are not available for mixed models.");
+    if (model->getNumberOfStates() >= 2 * model->getAlphabet()->getSize())
+    {
+      // Markov-modulated Markov model!
+      rDists.push_back(new ConstantRateDistribution());
+    }
+    else
+      rDists.push_back(PhylogeneticsApplicationTools::getRateDistribution(bppml.getParams(), suffix, true));
+  }
+
+  ApplicationTools::displayTask("Initializing partitioned likelihood");
+  PartitionedTreeLikelihood ptl(tree, sites, partitions, models, rDists, brLenLink == "proportional", nbThreads);
+  ApplicationTools::displayTaskDone();
+  ApplicationTools::displayResult("Initial log likelihood", TextTools::toString(ptl.getLogLikelihood(), 15));
+
+  string optimization = ApplicationTools::getStringParameter("optimization", bppml.getParams(), "FullD(derivatives=Newton)", "", true, 1);
+  if (optimization != "None")
+  {
+    double tolerance = ApplicationTools::getDoubleParameter("optimization.tolerance", bppml.getParams(), .000001, "", true, 1);
+    unsigned int maxRounds = ApplicationTools::getParameter<unsigned int>("partition.max_rounds", bppml.getParams(), 100, "", true, 2);
+    ApplicationTools::displayResult("Tolerance", tolerance);
+    ApplicationTools::displayResult("Maximum number of rounds", maxRounds);
+    unsigned int nbRounds = ptl.optimize(tolerance, maxRounds, true);
+    ApplicationTools::displayResult("Number of rounds performed", nbRounds);
+  }
+
+  ApplicationTools::displayResult("Log likelihood", TextTools::toString(ptl.getLogLikelihood(), 15));
+  for (size_t i = 0; i < ptl.getNumberOfPartitions(); i++)
+  {
+    const string& name = ptl.getPartition(i).name;
+    ApplicationTools::displayResult("Log likelihood of " + name, TextTools::toString(ptl.getLogLikelihood(i), 15));
+    if (brLenLink == "proportional")
+      ApplicationTools::displayResult("Branch length rate of " + name, TextTools::toString(ptl.getRate(i)));
+  }
+  unique_ptr<Tree> mlTree(ptl.getTree());
+  PhylogeneticsApplicationTools::writeTree(*mlTree, bppml.getParams());
+
+  string parametersFile = ApplicationTools::getAFilePath("output.estimates", bppml.getParams(), false, false, "none", 1);
+  bool withAlias = ApplicationTools::getBooleanParameter("output.estimates.alias", bppml.getParams(), true, "", true, 0);
+  ApplicationTools::displayResult("Output estimates to file", parametersFile);
+  if (parametersFile != "none")
+  {
+    size_t nbSites = 0;
+    for (size_t i = 0; i < ptl.getNumberOfPartitions(); i++)
+    {
+      nbSites += ptl.getPartition(i).sites.size();
+    }
+    StlOutputStream out(new ofstream(parametersFile.c_str(), ios::out));
+    out << "# Log likelihood = ";
+    out.setPrecision(20) << ptl.getLogLikelihood();
+    out.endLine();
+    out << "# Number of sites = ";
+    out.setPrecision(20) << nbSites;
+    out.endLine();
+    for (size_t i = 0; i < ptl.getNumberOfPartitions(); i++)
+    {
+      const Partition& partition = ptl.getPartition(i);
+      out.endLine();
+      (out << "# Partition " << partition.name << ":").endLine();
+      out << "# Log likelihood = ";
+      out.setPrecision(20) << ptl.getLogLikelihood(i);
+      out.endLine();
+      out << "# Number of sites = " << partition.sites.size();
+      out.endLine();
+      if (brLenLink == "proportional")
+      {
+        out << "# Branch length rate = ";
+        out.setPrecision(20) << ptl.getRate(i);
+        out.endLine();
+      }
+      ostringstream estimates;
+      StlOutputStreamWrapper estimatesOut(&estimates);
+      PhylogeneticsApplicationTools::printParameters(ptl.getModel(i), estimatesOut, 1, withAlias);
+      PhylogeneticsApplicationTools::printParameters(ptl.getRateDistribution(i), estimatesOut, withAlias);
+      out << addOptionSuffix(estimates.str(), "." + partition.name);
+    }
+  }
+}
+
+/******************************************************************************/
+
 int main(int args, char** argv)
 {
   cout << "******************************************************************" << endl;
@@ -120,6 +557,18 @@ int main(int args, char** argv)
     BppApplication bppml(args, argv, "BppML");
     bppml.startTimer();
 
+    // Merge the replicates of a sharded bootstrap analysis:
+    if (BootstrapTools::mergeShards(bppml.getParams()))
+    {
+      bppml.done();
+      return 0;
+    }
+
+    // Time spent in each phase of the analysis:
+    string perfFile = ApplicationTools::getAFilePath("output.perf.file", bppml.getParams(), false, false, "", true, "none", 1);
+    PerformanceMonitor perf;
+    perf.start("alignment");
+
     Alphabet* alphabet = SequenceApplicationTools::getAlphabet(bppml.getParams(), "", false);
     unique_ptr<GeneticCode> gCode;
     CodonAlphabet* codonAlphabet = dynamic_cast<CodonAlphabet*>(alphabet);
@@ -130,15 +579,23 @@ int main(int args, char** argv)
       gCode.reset(SequenceApplicationTools::getGeneticCode(codonAlphabet->getNucleicAlphabet(), codeDesc));
     }
 
-    VectorSiteContainer* allSites = SequenceApplicationTools::getSiteContainer(alphabet, bppml.getParams());
+    // Batch mode:
+    string sequenceList = ApplicationTools::getAFilePath("input.sequence.list", bppml.getParams(), false, true, "", true, "none", 1);
+    if (sequenceList != "none")
+    {
+      runBatch(bppml, alphabet, gCode.get(), sequenceList);
+      delete alphabet;
+      bppml.done();
+      return 0;
+    }
 
-    VectorSiteContainer* sites = SequenceApplicationTools::getSitesToAnalyse(*allSites, bppml.getParams(), "", true, false);
-    delete allSites;
+    VectorSiteContainer* sites = AlignmentCache::getSitesToAnalyse(alphabet, bppml.getParams(), "", true, false);
 
     ApplicationTools::displayResult("Number of sequences", TextTools::toString(sites->getNumberOfSequences()));
     ApplicationTools::displayResult("Number of sites", TextTools::toString(sites->getNumberOfSites()));
 
     // Get the initial tree
+    perf.start("tree");
     Tree* tree = 0;
     string initTreeOpt = ApplicationTools::getStringParameter("init.tree", bppml.getParams(), "user", "", false, 1);
     ApplicationTools::displayResult("Input tree", initTreeOpt);
@@ -154,6 +611,9 @@ int main(int args, char** argv)
       tree->setBranchLengths(1.);
     }
     else throw Exception("Unknown init tree method.");
+    unsigned int nbStarts = ApplicationTools::getParameter<unsigned int>("init.tree.number", bppml.getParams(), 1, "", true, 1);
+    if (nbStarts == 0)
+      throw Exception("The number of starting trees should be at least 1.");
 
     // Try to write the current tree to file. This will be overwritten by the optimized tree,
     // but allow to check file existence before running optimization!
@@ -238,13 +698,80 @@ int main(int args, char** argv)
       exit(0);
     }
 
+    // Partitioned analysis:
+    string partitionPath = ApplicationTools::getAFilePath("input.partition.file", bppml.getParams(), false, true, "", true, "none", 1);
+    if (partitionPath != "none")
+    {
+      perf.start("partitioned_likelihood");
+      runPartitioned(bppml, alphabet, gCode.get(), *sites, *tree, partitionPath);
+      perf.stop();
+      if (perfFile != "none")
+      {
+        ApplicationTools::displayResult("Performance report written to", perfFile);
+        perf.write(perfFile);
+      }
+      delete alphabet;
+      delete sites;
+      delete tree;
+      bppml.done();
+      return 0;
+    }
+
+    // Resume from a previous run?
+    unique_ptr<Checkpoint> checkpoint;
+    string checkpointPath = ApplicationTools::getAFilePath("optimization.checkpoint.file", bppml.getParams(), false, false, "", true, "none", 1);
+    if (checkpointPath != "none")
+    {
+      double checkpointInterval = ApplicationTools::getDoubleParameter("optimization.checkpoint.interval", bppml.getParams(), 600., "", true, 1);
+      ApplicationTools::displayResult("Checkpoint file", checkpointPath);
+      ApplicationTools::displayResult("Checkpoint interval (s)", checkpointInterval);
+      checkpoint.reset(new Checkpoint(checkpointPath, checkpointInterval));
+      if (checkpoint->restore() && checkpoint->hasValue("stage"))
+      {
+        ApplicationTools::displayResult("Resuming from stage", checkpoint->getValue("stage"));
+        delete tree;
+        tree = checkpoint->getTree("optimized.tree");
+      }
+    }
+
+    perf.start("likelihood_setup");
     DiscreteRatesAcrossSitesTreeLikelihood* tl;
     string nhOpt = ApplicationTools::getStringParameter("nonhomogeneous", bppml.getParams(), "no", "", true, 1);
     ApplicationTools::displayResult("Heterogeneous model", nhOpt);
 
     bool checkTree    = ApplicationTools::getBooleanParameter("input.tree.check_root", bppml.getParams(), true, "", true, 2);
     bool optimizeTopo = ApplicationTools::getBooleanParameter("optimization.topology", bppml.getParams(), false, "", true, 1);
+    string topoAlgo = ApplicationTools::getStringParameter("optimization.topology.algorithm", bppml.getParams(), "NNI", "", true, 2);
+    string topoAlgoName;
+    map<string, string> topoAlgoArgs;
+    KeyvalTools::parseProcedure(topoAlgo, topoAlgoName, topoAlgoArgs);
+    if (topoAlgoName != "NNI" && topoAlgoName != "SPR")
+      throw Exception("Unknown topology search algorithm: " + topoAlgo);
+    string nniMethod = ApplicationTools::getStringParameter("optimization.topology.algorithm_nni.method", bppml.getParams(), "phyml", "", true, 2);
+    unsigned int nniThreads = ParallelTools::getNumberOfThreads("optimization.topology.algorithm_nni.threads", bppml.getParams(), 2);
+    bool concurrentNNI = (topoAlgoName == "NNI" && nniMethod == "phyml" && nniThreads > 1);
+    // Each start is optimized like the main analysis with a sequential NNI search, other cases are not supported:
+    if (nbStarts > 1)
+    {
+      if (!optimizeTopo)
+        throw Exception("Multiple starting trees require optimization.topology = yes.");
+      if (topoAlgoName != "NNI")
+        throw Exception("Multiple starting trees are only supported with the NNI topology search.");
+      if (concurrentNNI)
+        throw Exception("Multiple starting trees are not supported with concurrent NNI searches (optimization.topology.algorithm_nni.threads > 1).");
+    }
     unsigned int nbBS = ApplicationTools::getParameter<unsigned int>("bootstrap.number", bppml.getParams(), 0, "", true, 1);
+    // Branch supports are checked before any likelihood is computed:
+    string supportMethod = ApplicationTools::getStringParameter("support.method", bppml.getParams(), "none", "", true, 1);
+    if (supportMethod != "none" && supportMethod != "aLRT_SH")
+      throw Exception("Unknown branch support method: " + supportMethod);
+    if (supportMethod == "aLRT_SH")
+    {
+      if (nhOpt != "no")
+        throw Exception("aLRT supports are only available for homogeneous, non-mixed models.");
+      if (nbBS > 0)
+        throw Exception("aLRT supports and bootstrap cannot be computed in the same run.");
+    }
 
     TransitionModel*    model    = 0;
     SubstitutionModelSet* modelSet = 0;
@@ -266,7 +793,7 @@ int main(int args, char** argv)
         rDist = PhylogeneticsApplicationTools::getRateDistribution(bppml.getParams());
       }
       if (dynamic_cast<MixedSubstitutionModel*>(model) == 0)
-        tl = new NNIHomogeneousTreeLikelihood(*tree, *sites, model, rDist, checkTree, true);
+        tl = new CountingTreeLikelihood<NNIHomogeneousTreeLikelihood>(*tree, *sites, model, rDist, checkTree, true);
       else
         throw Exception("Topology estimation with Mixed model not supported yet, sorry :(");
     }
@@ -284,6 +811,13 @@ int main(int args, char** argv)
         rDist = PhylogeneticsApplicationTools::getRateDistribution(bppml.getParams());
       }
       string recursion = ApplicationTools::getStringParameter("likelihood.recursion", bppml.getParams(), "simple", "", true, 1);
+      if (recursion == "auto")
+      {
+        size_t nbClasses = rDist->getNumberOfCategories();
+        if (dynamic_cast<MixedSubstitutionModel*>(model))
+          nbClasses *= dynamic_cast<MixedSubstitutionModel*>(model)->getNumberOfModels();
+        recursion = LikelihoodMemoryTools::chooseRecursion(*tree, *sites, nbClasses, model->getNumberOfStates(), bppml.getParams());
+      }
       ApplicationTools::displayResult("Likelihood recursion", recursion);
       if (recursion == "simple")
       {
@@ -291,24 +825,24 @@ int main(int args, char** argv)
         ApplicationTools::displayResult("Likelihood data compression", compression);
         if (compression == "simple")
           if (dynamic_cast<MixedSubstitutionModel*>(model))
-            tl = new RHomogeneousMixedTreeLikelihood(*tree, *sites, model, rDist, checkTree, true, false);
+            tl = new CountingTreeLikelihood<RHomogeneousMixedTreeLikelihood>(*tree, *sites, model, rDist, checkTree, true, false);
           else
-            tl = new RHomogeneousTreeLikelihood(*tree, *sites, model, rDist, checkTree, true, false);
+            tl = new CountingTreeLikelihood<RHomogeneousTreeLikelihood>(*tree, *sites, model, rDist, checkTree, true, false);
 
         else if (compression == "recursive")
           if (dynamic_cast<MixedSubstitutionModel*>(model) == 0)
-            tl = new RHomogeneousTreeLikelihood(*tree, *sites, model, rDist, checkTree, true, true);
+            tl = new CountingTreeLikelihood<RHomogeneousTreeLikelihood>(*tree, *sites, model, rDist, checkTree, true, true);
           else
-            tl = new RHomogeneousMixedTreeLikelihood(*tree, *sites, model, rDist, checkTree, true, true);
+            tl = new CountingTreeLikelihood<RHomogeneousMixedTreeLikelihood>(*tree, *sites, model, rDist, checkTree, true, true);
 
         else throw Exception("Unknown likelihood data compression method: " + compression);
       }
       else if (recursion == "double")
       {
         if (dynamic_cast<MixedSubstitutionModel*>(model))
-          tl = new DRHomogeneousMixedTreeLikelihood(*tree, *sites, model, rDist, checkTree);
+          tl = new CountingTreeLikelihood<DRHomogeneousMixedTreeLikelihood>(*tree, *sites, model, rDist, checkTree);
         else
-          tl = new DRHomogeneousTreeLikelihood(*tree, *sites, model, rDist, checkTree);
+          tl = new CountingTreeLikelihood<DRHomogeneousTreeLikelihood>(*tree, *sites, model, rDist, checkTree);
       }
       else throw Exception("Unknown recursion option: " + recursion);
     }
@@ -363,13 +897,21 @@ int main(int args, char** argv)
       model = 0;
 
       string recursion = ApplicationTools::getStringParameter("likelihood.recursion", bppml.getParams(), "simple", "", true, 1);
+      if (recursion == "auto")
+      {
+        // The double recursion is not available for mixed models here:
+        if (dynamic_cast<MixedSubstitutionModelSet*>(modelSet))
+          recursion = "simple";
+        else
+          recursion = LikelihoodMemoryTools::chooseRecursion(*tree, *sites, rDist->getNumberOfCategories(), modelSet->getNumberOfStates(), bppml.getParams());
+      }
       ApplicationTools::displayResult("Likelihood recursion", recursion);
       if (recursion == "simple")
       {
         if (dynamic_cast<MixedSubstitutionModelSet*>(modelSet)!=NULL)
-          tl = new RNonHomogeneousMixedTreeLikelihood(*tree, *sites, dynamic_cast<MixedSubstitutionModelSet*>(modelSet), rDist, true, true);
+          tl = new CountingTreeLikelihood<RNonHomogeneousMixedTreeLikelihood>(*tree, *sites, dynamic_cast<MixedSubstitutionModelSet*>(modelSet), rDist, true, true);
         else
-          tl = new RNonHomogeneousTreeLikelihood(*tree, *sites, modelSet, rDist, true, true);
+          tl = new CountingTreeLikelihood<RNonHomogeneousTreeLikelihood>(*tree, *sites, modelSet, rDist, true, true);
       }
       else if (recursion == "double")
       {
@@ -377,7 +919,7 @@ int main(int args, char** argv)
           throw Exception("Double recursion with non homogeneous mixed models is not implemented yet.");
             //            tl = new DRNonHomogeneousMixedTreeLikelihood(*tree, *sites, modelSet, rDist, true);
         else
-          tl = new DRNonHomogeneousTreeLikelihood(*tree, *sites, modelSet, rDist, true);
+          tl = new CountingTreeLikelihood<DRNonHomogeneousTreeLikelihood>(*tree, *sites, modelSet, rDist, true);
       }
       else throw Exception("Unknown recursion option: " + recursion);
     }
@@ -398,25 +940,37 @@ int main(int args, char** argv)
       }
 
       string recursion = ApplicationTools::getStringParameter("likelihood.recursion", bppml.getParams(), "simple", "", true, 1);
+      if (recursion == "auto")
+      {
+        // The double recursion is not available for mixed models here:
+        if (dynamic_cast<MixedSubstitutionModelSet*>(modelSet))
+          recursion = "simple";
+        else
+          recursion = LikelihoodMemoryTools::chooseRecursion(*tree, *sites, rDist->getNumberOfCategories(), modelSet->getNumberOfStates(), bppml.getParams());
+      }
       ApplicationTools::displayResult("Likelihood recursion", recursion);
       if (recursion == "simple")
       {
         if (dynamic_cast<MixedSubstitutionModelSet*>(modelSet)!=NULL)
-          tl = new RNonHomogeneousMixedTreeLikelihood(*tree, *sites, dynamic_cast<MixedSubstitutionModelSet*>(modelSet), rDist, true, true);
+          tl = new CountingTreeLikelihood<RNonHomogeneousMixedTreeLikelihood>(*tree, *sites, dynamic_cast<MixedSubstitutionModelSet*>(modelSet), rDist, true, true);
         else
-          tl = new RNonHomogeneousTreeLikelihood(*tree, *sites, modelSet, rDist, true, true);
+          tl = new CountingTreeLikelihood<RNonHomogeneousTreeLikelihood>(*tree, *sites, modelSet, rDist, true, true);
       }
       else if (recursion == "double")
         if (dynamic_cast<MixedSubstitutionModelSet*>(modelSet))
           throw Exception("Double recursion with non homogeneous mixed models is not implemented yet.");
             //            tl = new DRNonHomogeneousMixedTreeLikelihood(*tree, *sites, modelSet, rDist, true);
         else
-          tl = new DRNonHomogeneousTreeLikelihood(*tree, *sites, modelSet, rDist, true);
+          tl = new CountingTreeLikelihood<DRNonHomogeneousTreeLikelihood>(*tree, *sites, modelSet, rDist, true);
       else throw Exception("Unknown recursion option: " + recursion);
     }
     else throw Exception("Unknown option for nonhomogeneous: " + nhOpt);
+    if (supportMethod == "aLRT_SH" && dynamic_cast<MixedSubstitutionModel*>(model))
+      throw Exception("aLRT supports are only available for homogeneous, non-mixed models.");
 
+    perf.start("initialize");
     tl->initialize();
+    perf.stop();
 
     delete tree;
 
@@ -434,6 +988,10 @@ int main(int args, char** argv)
       exit(0);
     }
 
+    // Saturated sites removed from the analysis, kept for site-specific outputs:
+    vector<size_t> saturatedSiteIndices;
+    vector< shared_ptr<Site> > saturatedSites;
+
     //Check initial likelihood:
     double logL = tl->getValue();
     if (std::isinf(logL))
@@ -487,12 +1045,16 @@ int main(int args, char** argv)
         exit(1);
       } else {
         ApplicationTools::displayBooleanResult("Saturated site removal enabled", true);
-        for (size_t i = sites->getNumberOfSites(); i > 0; --i) {
-          if (std::isinf(tl->getLogLikelihoodForASite(i - 1))) {
-            ApplicationTools::displayResult("Ignore saturated site", sites->getSite(i - 1).getPosition());
-            sites->deleteSite(i - 1);
+        vector<bool> saturated(sites->getNumberOfSites());
+        for (size_t i = 0; i < sites->getNumberOfSites(); i++) {
+          saturated[i] = std::isinf(tl->getLogLikelihoodForASite(i));
+          if (saturated[i]) {
+            ApplicationTools::displayResult("Ignore saturated site", sites->getSite(i).getPosition());
+            saturatedSiteIndices.push_back(i);
+            saturatedSites.push_back(shared_ptr<Site>(sites->getSite(i).clone()));
           }
         }
+        SiteFilterTools::removeSites(*sites, saturated);
         ApplicationTools::displayResult("Number of sites retained", sites->getNumberOfSites());
         tl->setData(*sites);
         tl->initialize();
@@ -504,12 +1066,176 @@ int main(int args, char** argv)
       }
     }
 
-    tl = dynamic_cast<DiscreteRatesAcrossSitesTreeLikelihood*>(
-      PhylogeneticsApplicationTools::optimizeParameters(tl, tl->getParameters(), bppml.getParams()));
+    // Without a topology search, the parameters are also backed up during the main optimization, and restored
+    // from the backup file by the optimizer when resuming. Backups do not store the tree, hence the restriction:
+    string checkpointBackup = "none";
+    if (checkpoint && !checkpoint->hasValue("stage") && !optimizeTopo && nbStarts <= 1
+        && ApplicationTools::getStringParameter("optimization.backup.file", bppml.getParams(), "none", "", true, 3) == "none")
+    {
+      checkpointBackup = checkpointPath + ".backup";
+      ApplicationTools::displayResult("Checkpoint backup file", checkpointBackup);
+    }
+
+    perf.start("optimization");
+    if (checkpoint && checkpoint->hasValue("stage"))
+    {
+      if (checkpoint->getValue("sites") != TextTools::toString(sites->getNumberOfSites()))
+        throw Exception("The checkpoint file " + checkpointPath + " was not created with the same data set. Remove it to start from scratch.");
+      tl->matchParametersValues(checkpoint->getParameters("optimized.parameters"));
+      ApplicationTools::displayResult("Restored log likelihood", TextTools::toString(-tl->getValue(), 15));
+    }
+    else if (nbStarts > 1)
+    {
+      if (!model || dynamic_cast<MixedSubstitutionModel*>(model))
+        throw Exception("Multiple starting trees are only supported with homogeneous, non-mixed models.");
+      string startType = ApplicationTools::getStringParameter("init.tree.starts", bppml.getParams(), "parsimony", "", true, 1);
+      if (startType != "random" && startType != "parsimony")
+        throw Exception("Unknown type of starting trees: " + startType);
+      unsigned int startThreads = ParallelTools::getNumberOfThreads("init.tree.threads", bppml.getParams(), 1);
+      ApplicationTools::displayResult("Number of starting trees", nbStarts);
+      ApplicationTools::displayResult("Additional starting trees", startType);
+      ApplicationTools::displayResult("Number of threads for starting trees", startThreads);
+
+      // The first start is the input tree. Random trees are drawn here, so that they only depend on the seed:
+      vector< shared_ptr<Tree> > startTrees(nbStarts);
+      startTrees[0].reset(tl->getTree().clone());
+      vector<string> names = sites->getSequencesNames();
+      for (unsigned int k = 1; k < nbStarts; k++)
+      {
+        startTrees[k].reset(TreeTemplateTools::getRandomTree(names, false));
+        startTrees[k]->setBranchLengths(0.1);
+      }
+      map<string, string> startParams = bppml.getParams();
+      if (startThreads > 1)
+      {
+        startParams["optimization.verbose"] = "0";
+        startParams["optimization.message_handler"] = "none";
+        startParams["optimization.profiler"] = "none";
+        startParams["optimization.backup.file"] = "none";
+      }
+
+      // Each start has its own copy of the model and rate distribution:
+      vector<double> startLogL(nbStarts);
+      vector< shared_ptr<Tree> > startResults(nbStarts);
+      vector<ParameterList> startParameters(nbStarts);
+      ParallelTools::parallelFor(nbStarts, startThreads, [&](size_t k, unsigned int) {
+        unique_ptr<TransitionModel> modelStart(model->clone());
+        unique_ptr<DiscreteDistribution> rDistStart(rDist->clone());
+        shared_ptr<Tree> startTree = startTrees[k];
+        if (k > 0 && startType == "parsimony")
+        {
+          unique_ptr<DRTreeParsimonyScore> tp(new DRTreeParsimonyScore(*startTree, *sites, false, false));
+          tp.reset(OptimizationTools::optimizeTreeNNI(tp.release(), 0));
+          startTree.reset(new TreeTemplate<Node>(tp->getTree()));
+          startTree->setBranchLengths(0.1);
+        }
+        NNIHomogeneousTreeLikelihood* tlStart = new CountingTreeLikelihood<NNIHomogeneousTreeLikelihood>(*startTree, *sites, modelStart.get(), rDistStart.get(), checkTree, false);
+        tlStart->initialize();
+        tlStart = dynamic_cast<NNIHomogeneousTreeLikelihood*>(
+          PhylogeneticsApplicationTools::optimizeParameters(tlStart, tlStart->getParameters(), startParams, "", true, false));
+        startLogL[k] = -tlStart->getValue();
+        startResults[k].reset(tlStart->getTree().clone());
+        startParameters[k] = tlStart->getParameters();
+        delete tlStart;
+      });
+
+      size_t bestStart = 0;
+      for (size_t k = 0; k < nbStarts; k++)
+      {
+        ApplicationTools::displayResult("Log likelihood for starting tree " + TextTools::toString(k + 1), TextTools::toString(startLogL[k], 15));
+        if (startLogL[k] > startLogL[bestStart])
+          bestStart = k;
+      }
+      ApplicationTools::displayResult("Best starting tree", bestStart + 1);
+      DiscreteRatesAcrossSitesTreeLikelihood* bestTl = new CountingTreeLikelihood<NNIHomogeneousTreeLikelihood>(*startResults[bestStart], *sites, model, rDist, checkTree, false);
+      bestTl->initialize();
+      bestTl->matchParametersValues(startParameters[bestStart]);
+      delete tl;
+      tl = bestTl;
+    }
+    else if (optimizeTopo && topoAlgoName == "SPR")
+    {
+      unsigned int sprRadius = ApplicationTools::getParameter<unsigned int>("radius", topoAlgoArgs, 3, "", true, 2);
+      unsigned int sprCandidates = ApplicationTools::getParameter<unsigned int>("candidates", topoAlgoArgs, 5, "", true, 2);
+      unsigned int sprRounds = ApplicationTools::getParameter<unsigned int>("rounds", topoAlgoArgs, 0, "", true, 2);
+      double sprTolerance = ApplicationTools::getDoubleParameter("tolerance", topoAlgoArgs, 0.01, "", true, 2);
+      unsigned int sprThreads = ParallelTools::getNumberOfThreads("threads", topoAlgoArgs, 2);
+      ApplicationTools::displayResult("SPR regrafting radius", sprRadius);
+      ApplicationTools::displayResult("SPR candidates fully optimized", sprCandidates);
+      ApplicationTools::displayResult("Number of SPR threads", sprThreads);
+
+      // Numerical parameters are estimated before and after the topology search:
+      map<string, string> numParams = bppml.getParams();
+      numParams["optimization.topology"] = "no";
+      tl = dynamic_cast<DiscreteRatesAcrossSitesTreeLikelihood*>(
+        PhylogeneticsApplicationTools::optimizeParameters(tl, tl->getParameters(), numParams));
+      unique_ptr< TreeTemplate<Node> > sprTree(TopologySearchTools::optimizeTreeSPR(
+        tl->getTree(), *sites, *model, *rDist, sprRadius, sprCandidates, sprRounds, sprTolerance, sprThreads));
+      DiscreteRatesAcrossSitesTreeLikelihood* sprTl = new CountingTreeLikelihood<NNIHomogeneousTreeLikelihood>(*sprTree, *sites, model, rDist, checkTree, false);
+      sprTl->initialize();
+      delete tl;
+      tl = dynamic_cast<DiscreteRatesAcrossSitesTreeLikelihood*>(
+        PhylogeneticsApplicationTools::optimizeParameters(sprTl, sprTl->getParameters(), numParams));
+    }
+    else if (optimizeTopo && concurrentNNI)
+    {
+      ApplicationTools::displayResult("Number of NNI threads", nniThreads);
+      tl = optimizeParametersWithConcurrentNNI(tl, tl->getParameters(), *sites, model, rDist, bppml.getParams(), nniThreads, checkTree);
+    }
+    else
+    {
+      map<string, string> optParams = bppml.getParams();
+      if (checkpointBackup != "none")
+        optParams["optimization.backup.file"] = checkpointBackup;
+      tl = dynamic_cast<DiscreteRatesAcrossSitesTreeLikelihood*>(
+        PhylogeneticsApplicationTools::optimizeParameters(tl, tl->getParameters(), optParams));
+    }
+    if (checkpoint && !checkpoint->hasValue("stage"))
+    {
+      checkpoint->setValue("stage", "optimized");
+      checkpoint->setValue("sites", TextTools::toString(sites->getNumberOfSites()));
+      checkpoint->setTree("optimized.tree", tl->getTree());
+      checkpoint->setParameters("optimized.parameters", tl->getParameters());
+      checkpoint->save();
+      // The optimizer renames its backup file with a .def suffix when it completes:
+      if (checkpointBackup != "none")
+      {
+        remove(checkpointBackup.c_str());
+        remove((checkpointBackup + ".def").c_str());
+      }
+    }
 
     tree = new TreeTemplate<Node>(tl->getTree());
     PhylogeneticsApplicationTools::writeTree(*tree, bppml.getParams());
 
+    // Branch supports:
+    if (supportMethod == "aLRT_SH")
+    {
+      unsigned int nbReplicates = ApplicationTools::getParameter<unsigned int>("support.replicates", bppml.getParams(), 1000, "", true, 2);
+      unsigned int supportThreads = ParallelTools::getNumberOfThreads("support.threads", bppml.getParams(), 2);
+      unsigned int supportSeed = BootstrapTools::getSeed(bppml.getParams(), 2);
+      double supportTolerance = ApplicationTools::getDoubleParameter("optimization.tolerance", bppml.getParams(), .000001, "", true, 3);
+      ApplicationTools::displayResult("Branch support", supportMethod);
+      ApplicationTools::displayResult("Number of RELL replicates", nbReplicates);
+      ApplicationTools::displayResult("Number of support threads", supportThreads);
+      perf.start("support");
+      TreeTemplate<Node> supportTree(*tree);
+      if (supportTree.isRooted())
+        supportTree.unroot();
+      ApplicationTools::displayTask("Computing aLRT supports");
+      map<int, double> supports = TopologySearchTools::computeSHLikeSupports(
+        supportTree, *sites, *model, *rDist, nbReplicates, supportSeed, supportThreads, supportTolerance);
+      ApplicationTools::displayTaskDone();
+      TreeTemplate<Node>* ttree = dynamic_cast<TreeTemplate<Node>*>(tree);
+      for (map<int, double>::iterator it = supports.begin(); it != supports.end(); ++it)
+      {
+        if (ttree->hasNode(it->first))
+          ttree->getNode(it->first)->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(100. * it->second));
+      }
+      perf.stop();
+      PhylogeneticsApplicationTools::writeTree(*tree, bppml.getParams());
+    }
+
     // Write parameters to screen:
     ApplicationTools::displayResult("Log likelihood", TextTools::toString(-tl->getValue(), 15));
     ParameterList parameters = tl->getSubstitutionModelParameters();
@@ -560,17 +1286,20 @@ int main(int args, char** argv)
     }
 
     // Getting posterior rate class distribution:
+    perf.start("posterior_rates");
     DiscreteDistribution* prDist = RASTools::getPosteriorRateDistribution(*tl);
     ApplicationTools::displayMessage("\nPosterior rate distribution for dataset:\n");
     if (ApplicationTools::message) prDist->print(*ApplicationTools::message);
     ApplicationTools::displayMessage("\n");
     delete prDist;
+    perf.stop();
 
     // Write infos to file:
     string infosFile = ApplicationTools::getAFilePath("output.infos", bppml.getParams(), false, false);
     if (infosFile != "none")
     {
       ApplicationTools::displayResult("Alignment information logfile", infosFile);
+      perf.start("output_infos");
       ofstream out(infosFile.c_str(), ios::out);
 
       // Get the rate class with maximum posterior probability:
@@ -589,10 +1318,12 @@ int main(int args, char** argv)
       vector<string> row(6);
       DataTable* infos = new DataTable(colNames);
 
-      for (unsigned int i = 0; i < sites->getNumberOfSites(); i++)
+      // Saturated sites are reported at their original position, with NA values:
+      size_t nbSites = sites->getNumberOfSites() + saturatedSites.size();
+      for (size_t k = 0, i = 0, j = 0; k < nbSites; k++)
       {
-        double lnL = tl->getLogLikelihoodForASite(i);
-        const Site* currentSite = &sites->getSite(i);
+        bool isSaturated = (j < saturatedSiteIndices.size() && saturatedSiteIndices[j] == k);
+        const Site* currentSite = isSaturated ? saturatedSites[j].get() : &sites->getSite(i);
         int currentSitePosition = currentSite->getPosition();
         string isCompl = "NA";
         string isConst = "NA";
@@ -603,15 +1334,27 @@ int main(int args, char** argv)
         row[0] = (string("[" + TextTools::toString(currentSitePosition) + "]"));
         row[1] = isCompl;
         row[2] = isConst;
-        row[3] = TextTools::toString(lnL);
-        row[4] = TextTools::toString(classes[i]);
-        row[5] = TextTools::toString(rates[i]);
+        if (isSaturated)
+        {
+          row[3] = "NA";
+          row[4] = "NA";
+          row[5] = "NA";
+          j++;
+        }
+        else
+        {
+          row[3] = TextTools::toString(tl->getLogLikelihoodForASite(i));
+          row[4] = TextTools::toString(classes[i]);
+          row[5] = TextTools::toString(rates[i]);
+          i++;
+        }
         infos->addRow(row);
       }
 
       DataTable::write(*infos, out, "\t");
 
       delete infos;
+      perf.stop();
     }
 
 
@@ -623,23 +1366,90 @@ int main(int args, char** argv)
     }
     if (nbBS > 0 && optimizeClock == "None")
     {
+      perf.start("bootstrap");
       ApplicationTools::displayResult("Number of bootstrap samples", TextTools::toString(nbBS));
       bool approx = ApplicationTools::getBooleanParameter("bootstrap.approximate", bppml.getParams(), true, "", true, 2);
       ApplicationTools::displayBooleanResult("Use approximate bootstrap", approx);
       bool bootstrapVerbose = ApplicationTools::getBooleanParameter("bootstrap.verbose", bppml.getParams(), false, "", true, 2);
+      string bsMethod = ApplicationTools::getStringParameter("bootstrap.method", bppml.getParams(), "full", "", true, 2);
+      if (bsMethod != "full" && bsMethod != "RELL")
+        throw Exception("Unknown bootstrap method: " + bsMethod);
+      ApplicationTools::displayResult("Bootstrap method", bsMethod);
 
       const Tree* initTree = tree;
+      unique_ptr<Tree> restoredInitTree;
       if (!bootstrapVerbose) bppml.getParam("optimization.verbose") = "0";
       bppml.getParam("optimization.profiler") = "none";
       bppml.getParam("optimization.messageHandler") = "none";
-      if (!optimizeTopo)
+      // Replicates always search the topology, including those computed after resuming from a checkpoint:
+      bppml.getParam("optimization.topology") = "yes";
+      bool bootstrapStarted = checkpoint && checkpoint->getValue("stage") == "bootstrap";
+      if (bootstrapStarted)
+      {
+        restoredInitTree.reset(checkpoint->getTree("bootstrap.tree"));
+        initTree = restoredInitTree.get();
+        model->matchParametersValues(checkpoint->getParameters("bootstrap.parameters"));
+        rDist->matchParametersValues(checkpoint->getParameters("bootstrap.parameters"));
+      }
+      else if (!optimizeTopo)
       {
-        bppml.getParam("optimization.topology") = "yes";
-        tl = dynamic_cast<NNIHomogeneousTreeLikelihood*>(
-            PhylogeneticsApplicationTools::optimizeParameters(tl, tl->getParameters(), bppml.getParams(), "", true, false));
+        if (concurrentNNI)
+          tl = optimizeParametersWithConcurrentNNI(tl, tl->getParameters(), *sites, model, rDist, bppml.getParams(), nniThreads, checkTree);
+        else
+          tl = dynamic_cast<NNIHomogeneousTreeLikelihood*>(
+              PhylogeneticsApplicationTools::optimizeParameters(tl, tl->getParameters(), bppml.getParams(), "", true, false));
         initTree = &tl->getTree();
       }
 
+      if (dynamic_cast<MixedSubstitutionModel*>(model) != NULL)
+        throw Exception("Bootstrap estimation with Mixed model not supported yet, sorry :(");
+
+      unsigned int nbThreads = ParallelTools::getNumberOfThreads("bootstrap.threads", bppml.getParams(), 2);
+      ApplicationTools::displayResult("Number of bootstrap threads", nbThreads);
+      // NNI threads are shared among the replicates running concurrently (this only affects scheduling):
+      unsigned int nniThreadsRep = max(1u, nniThreads / nbThreads);
+      unsigned int bsSeed = bootstrapStarted ?
+          TextTools::to<unsigned int>(checkpoint->getValue("bootstrap.seed")) :
+          BootstrapTools::getSeed(bppml.getParams(), 2);
+      ApplicationTools::displayResult("Bootstrap seed", bsSeed);
+      size_t bsBegin, bsEnd;
+      bool sharded = BootstrapTools::getShard(bppml.getParams(), nbBS, bsBegin, bsEnd, 2);
+      size_t nbShardBS = bsEnd - bsBegin;
+
+      // Stop adding replicates when bootstrap values do not change anymore:
+      double convergence = 0;
+      size_t convergenceBatch = 0;
+      string convergenceDesc = ApplicationTools::getStringParameter("bootstrap.convergence", bppml.getParams(), "none", "", true, 2);
+      if (convergenceDesc != "none")
+      {
+        if (sharded)
+          throw Exception("'bootstrap.convergence' cannot be used when replicates are sharded.");
+        convergence = TextTools::toDouble(convergenceDesc);
+        if (convergence <= 0)
+          throw Exception("'bootstrap.convergence' should be a positive number: " + convergenceDesc);
+        convergenceBatch = ApplicationTools::getParameter<size_t>("bootstrap.convergence.batch", bppml.getParams(), 50, "", true, 2);
+        if (convergenceBatch == 0)
+          throw Exception("'bootstrap.convergence.batch' should be at least 1.");
+        ApplicationTools::displayResult("Bootstrap convergence threshold", convergence);
+        ApplicationTools::displayResult("Replicates per batch", convergenceBatch);
+      }
+
+      // Optionally resample the patterns already compressed by the likelihood object, rather than the full alignment.
+      // Replicates are still expanded to the full alignment size, so this only saves random draws:
+      string resampling = ApplicationTools::getStringParameter("bootstrap.resampling", bppml.getParams(), "sites", "", true, 2);
+      ApplicationTools::displayResult("Bootstrap resampling", resampling);
+      const SiteContainer* patterns = 0;
+      vector<unsigned int> patternWeights;
+      if (resampling == "patterns")
+      {
+        const DRASDRTreeLikelihoodData* data = dynamic_cast<DRHomogeneousTreeLikelihood*>(tl)->getLikelihoodData();
+        patterns = data->getShrunkData();
+        patternWeights = data->getWeights();
+        ApplicationTools::displayResult("Number of distinct patterns", patterns->getNumberOfSites());
+      }
+      else if (resampling != "sites")
+        throw Exception("Unknown bootstrap resampling method: " + resampling);
+
       string bsTreesPath = ApplicationTools::getAFilePath("bootstrap.output.file", bppml.getParams(), false, false);
       ofstream* out = 0;
       if (bsTreesPath != "none")
@@ -647,54 +1457,251 @@ int main(int args, char** argv)
         ApplicationTools::displayResult("Bootstrap trees stored in file", bsTreesPath);
         out = new ofstream(bsTreesPath.c_str(), ios::out);
       }
+      else if (sharded)
+        throw Exception("'bootstrap.output.file' must be set when replicates are sharded.");
       Newick newick;
       ParameterList paramsToIgnore = tl->getSubstitutionModelParameters();
       paramsToIgnore.addParameters(tl->getRateDistributionParameters());
 
+      // Each worker gets its own copy of the model, rate distribution and options,
+      // reset to the ML estimates before each replicate:
+      vector<TransitionModel*> workerModels(nbThreads);
+      vector<DiscreteDistribution*> workerRDists(nbThreads);
+      vector< map<string, string> > workerParams(nbThreads, bppml.getParams());
+      for (unsigned int w = 0; w < nbThreads; w++)
+      {
+        workerModels[w] = model->clone();
+        workerRDists[w] = rDist->clone();
+        if (nbThreads > 1)
+        {
+          workerParams[w]["optimization.verbose"] = "0";
+          workerParams[w]["optimization.message_handler"] = "none";
+          workerParams[w]["optimization.profiler"] = "none";
+          workerParams[w]["optimization.backup.file"] = "none";
+        }
+      }
+      ParameterList modelParameters = model->getParameters();
+      ParameterList rDistParameters = rDist->getParameters();
+
+      vector<Tree*> bsTrees(nbBS, 0);
+      size_t nbDone = 0;
+      if (checkpoint)
+      {
+        if (bootstrapStarted)
+        {
+          for (size_t i = bsBegin; i < bsEnd; i++)
+          {
+            string key = "replicate." + TextTools::toString(i);
+            if (checkpoint->hasValue(key))
+            {
+              bsTrees[i] = checkpoint->getTree(key);
+              nbDone++;
+            }
+          }
+          ApplicationTools::displayResult("Replicates restored", nbDone);
+        }
+        else
+        {
+          ParameterList bsParameters = modelParameters;
+          bsParameters.addParameters(rDistParameters);
+          checkpoint->setValue("stage", "bootstrap");
+          checkpoint->setValue("bootstrap.seed", TextTools::toString(bsSeed));
+          checkpoint->setTree("bootstrap.tree", *initTree);
+          checkpoint->setParameters("bootstrap.parameters", bsParameters);
+          checkpoint->save();
+        }
+      }
+
       ApplicationTools::displayTask("Bootstrapping", true);
-      vector<Tree*> bsTrees(nbBS);
-      for (unsigned int i = 0; i < nbBS; i++)
+      // Trees are written in replicate order, as soon as all previous ones are available:
+      size_t nbWritten = bsBegin;
+      size_t batchEnd = bsBegin;
+      auto writeAvailableTrees = [&]() {
+        while (nbWritten < batchEnd && bsTrees[nbWritten])
+        {
+          if (out) newick.write(*bsTrees[nbWritten], bsTreesPath, nbWritten == bsBegin);
+          nbWritten++;
+        }
+      };
+      vector<bool> restored(nbBS);
+      for (size_t i = 0; i < nbBS; i++)
+      {
+        restored[i] = (bsTrees[i] != 0);
+      }
+
+      // Candidate trees of the RELL bootstrap are the ML tree and its NNI neighbors, with their central branch optimized.
+      // Their pattern log-likelihoods are computed once, and each replicate only reweights them:
+      vector<unsigned int> rellWeights;
+      vector< shared_ptr< TreeTemplate<Node> > > candidates;
+      vector< vector<double> > candidateLogL;
+      if (bsMethod == "RELL")
       {
-        ApplicationTools::displayGauge(i, nbBS - 1, '=');
-        VectorSiteContainer* sample = SiteContainerTools::bootstrapSites(*sites);
-        if (!approx)
+        rellWeights = dynamic_cast<DRHomogeneousTreeLikelihood*>(tl)->getLikelihoodData()->getWeights();
+        double rellTolerance = ApplicationTools::getDoubleParameter("optimization.tolerance", bppml.getParams(), .000001, "", true, 3);
+        TreeTemplate<Node> mlTree(*initTree);
+        if (mlTree.isRooted())
+          mlTree.unroot();
+        vector<NNIMove> moves = TopologySearchTools::getNNIMoves(mlTree);
+        candidates.resize(moves.size() + 1);
+        candidateLogL.resize(candidates.size());
+        ParallelTools::parallelFor(candidates.size(), nbThreads, [&](size_t c, unsigned int w) {
+          workerModels[w]->matchParametersValues(modelParameters);
+          workerRDists[w]->matchParametersValues(rDistParameters);
+          shared_ptr< TreeTemplate<Node> > candidate(new TreeTemplate<Node>(mlTree));
+          if (c > 0)
+          {
+            // The central branch is above the father of the moved node, which changes with the move:
+            vector<int> central(1, mlTree.getNode(moves[c - 1].son)->getFather()->getId());
+            TopologySearchTools::applyNNIMove(*candidate, moves[c - 1]);
+            TopologySearchTools::optimizeBranchLengths(*candidate, *sites, workerModels[w], workerRDists[w], central, rellTolerance, 100, &candidateLogL[c]);
+          }
+          else
+            candidateLogL[c] = TopologySearchTools::getPatternLogLikelihoods(*candidate, *sites, workerModels[w], workerRDists[w]);
+          candidates[c] = candidate;
+        });
+        ApplicationTools::displayResult("Number of RELL candidate trees", candidates.size());
+      }
+
+      // Replicates are computed by batches when checking convergence, all at once otherwise:
+      size_t nbUsedBS = bsEnd;
+      vector<double> previousSupports;
+      for (size_t batchBegin = bsBegin; batchBegin < bsEnd; batchBegin = batchEnd)
+      {
+        batchEnd = convergence > 0 ? min(batchBegin + convergenceBatch, bsEnd) : bsEnd;
+        writeAvailableTrees();
+        if (bsMethod == "RELL")
         {
-          model->setFreqFromData(*sample);
+          for (size_t i = batchBegin; i < batchEnd; i++)
+          {
+            if (bsTrees[i]) continue;
+            vector<unsigned int> weights = BootstrapTools::bootstrapWeights(rellWeights, bsSeed, i);
+            size_t best = 0;
+            double bestLogL = -numeric_limits<double>::infinity();
+            for (size_t c = 0; c < candidates.size(); c++)
+            {
+              double replicateLogL = 0;
+              for (size_t j = 0; j < weights.size(); j++)
+              {
+                if (weights[j] > 0) replicateLogL += weights[j] * candidateLogL[c][j];
+              }
+              if (replicateLogL > bestLogL)
+              {
+                bestLogL = replicateLogL;
+                best = c;
+              }
+            }
+            bsTrees[i] = candidates[best]->clone();
+            ApplicationTools::displayGauge(++nbDone, nbShardBS, '=');
+          }
+          writeAvailableTrees();
         }
+        else
+        {
+          mutex bsMutex;
+          ParallelTools::parallelFor(batchEnd - batchBegin, nbThreads, [&](size_t k, unsigned int w) {
+            size_t i = batchBegin + k;
+            if (restored[i]) return;
+            Stopwatch replicateTime(true);
+            TransitionModel* modelRep = workerModels[w];
+            DiscreteDistribution* rDistRep = workerRDists[w];
+            modelRep->matchParametersValues(modelParameters);
+            rDistRep->matchParametersValues(rDistParameters);
+            unique_ptr<VectorSiteContainer> sample(patterns ?
+                BootstrapTools::getSitesFromPatterns(*patterns, BootstrapTools::bootstrapWeights(patternWeights, bsSeed, i)) :
+                BootstrapTools::bootstrapSites(*sites, bsSeed, i));
+            if (!approx)
+            {
+              modelRep->setFreqFromData(*sample);
+            }
 
-        if (dynamic_cast<MixedSubstitutionModel*>(model) != NULL)
-          throw Exception("Bootstrap estimation with Mixed model not supported yet, sorry :(");
+            NNIHomogeneousTreeLikelihood* tlRep = new CountingTreeLikelihood<NNIHomogeneousTreeLikelihood>(*initTree, *sample, modelRep, rDistRep, true, false);
+            tlRep->initialize();
+            ParameterList parametersRep = tlRep->getParameters();
+            if (approx)
+            {
+              parametersRep.deleteParameters(paramsToIgnore.getParameterNames());
+            }
+            // The algorithm does not depend on the number of threads, which are only used for scheduling:
+            if (concurrentNNI)
+              tlRep = optimizeParametersWithConcurrentNNI(tlRep, parametersRep, *sample, modelRep, rDistRep, workerParams[w], nniThreadsRep, true);
+            else
+              tlRep = dynamic_cast<NNIHomogeneousTreeLikelihood*>(
+                PhylogeneticsApplicationTools::optimizeParameters(tlRep, parametersRep, workerParams[w], "", true, false));
+            Tree* bsTree = new TreeTemplate<Node>(tlRep->getTree());
+            delete tlRep;
+            perf.addPhase("bootstrap_replicate_" + TextTools::toString(i), replicateTime);
+
+            lock_guard<mutex> lock(bsMutex);
+            bsTrees[i] = bsTree;
+            ApplicationTools::displayGauge(++nbDone, nbShardBS, '=');
+            writeAvailableTrees();
+            if (checkpoint)
+            {
+              checkpoint->setTree("replicate." + TextTools::toString(i), *bsTree);
+              checkpoint->saveIfDue();
+            }
+          });
+        }
 
-        NNIHomogeneousTreeLikelihood* tlRep = new NNIHomogeneousTreeLikelihood(*initTree, *sample, model, rDist, true, false);
-        tlRep->initialize();
-        ParameterList parametersRep = tlRep->getParameters();
-        if (approx)
+        // Compare the bootstrap values of the reference tree with the ones of the previous batch:
+        if (convergence > 0 && batchEnd < bsEnd)
         {
-          parametersRep.deleteParameters(paramsToIgnore.getParameterNames());
+          vector<Tree*> batchTrees(bsTrees.begin(), bsTrees.begin() + static_cast<ptrdiff_t>(batchEnd));
+          vector<double> supports = BootstrapTools::getBootstrapValues(*tree, batchTrees);
+          if (previousSupports.size() == supports.size())
+          {
+            double maxChange = 0;
+            for (size_t j = 0; j < supports.size(); j++)
+            {
+              maxChange = max(maxChange, abs(supports[j] - previousSupports[j]));
+            }
+            if (maxChange < convergence)
+            {
+              nbUsedBS = batchEnd;
+              break;
+            }
+          }
+          previousSupports = supports;
         }
-        tlRep = dynamic_cast<NNIHomogeneousTreeLikelihood*>(
-          PhylogeneticsApplicationTools::optimizeParameters(tlRep, parametersRep, bppml.getParams(), "", true, false));
-        bsTrees[i] = new TreeTemplate<Node>(tlRep->getTree());
-        if (out && i == 0) newick.write(*bsTrees[i], bsTreesPath, true);
-        if (out && i >  0) newick.write(*bsTrees[i], bsTreesPath, false);
-        delete tlRep;
-        delete sample;
       }
+      if (checkpoint) checkpoint->save();
       if (out) out->close();
       if (out) delete out;
+      for (unsigned int w = 0; w < nbThreads; w++)
+      {
+        delete workerModels[w];
+        delete workerRDists[w];
+      }
       ApplicationTools::displayTaskDone();
+      if (convergence > 0)
+      {
+        ApplicationTools::displayResult("Number of replicates used", nbUsedBS);
+        // Replicates after convergence may have been restored from a checkpoint:
+        for (size_t i = nbUsedBS; i < nbBS; i++)
+        {
+          delete bsTrees[i];
+        }
+        bsTrees.resize(nbUsedBS);
+      }
 
+      if (sharded)
+      {
+        // Bootstrap values are computed when merging all shards:
+        ApplicationTools::displayMessage("Shard done. Use 'bootstrap.merge' to compute bootstrap values.");
+      }
+      else
+      {
+        ApplicationTools::displayTask("Compute bootstrap values");
+        TreeTools::computeBootstrapValues(*tree, bsTrees);
+        ApplicationTools::displayTaskDone();
 
-      ApplicationTools::displayTask("Compute bootstrap values");
-      TreeTools::computeBootstrapValues(*tree, bsTrees);
-      ApplicationTools::displayTaskDone();
-      for (unsigned int i = 0; i < nbBS; i++)
+        // Write resulting tree:
+        PhylogeneticsApplicationTools::writeTree(*tree, bppml.getParams());
+      }
+      for (size_t i = 0; i < bsTrees.size(); i++)
       {
         delete bsTrees[i];
       }
-
-      // Write resulting tree:
-      PhylogeneticsApplicationTools::writeTree(*tree, bppml.getParams());
     }
 
 
@@ -703,6 +1710,13 @@ int main(int args, char** argv)
     if (model) delete model;
     if (modelSet) delete modelSet;
     delete rDist;
+    perf.stop();
+    if (perfFile != "none")
+    {
+      ApplicationTools::displayResult("Performance report written to", perfFile);
+      perf.write(perfFile);
+    }
+
     delete tl;
     delete tree;
     bppml.done();
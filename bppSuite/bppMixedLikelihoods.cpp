@@ -80,6 +80,9 @@ using namespace std;
 #include <Bpp/Phyl/Likelihood/RNonHomogeneousMixedTreeLikelihood.h>
 #include <Bpp/Phyl/Io/Newick.h>
 
+// From bppsuite:
+#include "SiteFilterTools.h"
+
 using namespace bpp;
 
 /******************************************************************************/
@@ -126,10 +129,7 @@ int main(int args, char** argv)
 
     // get the data
 
-    VectorSiteContainer* allSites = SequenceApplicationTools::getSiteContainer(alphabet, bppmixedlikelihoods.getParams());
-
-    VectorSiteContainer* sites = SequenceApplicationTools::getSitesToAnalyse(*allSites, bppmixedlikelihoods.getParams(), "", true, false);
-    delete allSites;
+    VectorSiteContainer* sites = SiteFilterTools::getSitesToAnalyse(alphabet, bppmixedlikelihoods.getParams(), "", true, false);
 
     ApplicationTools::displayResult("Number of sequences", TextTools::toString(sites->getNumberOfSequences()));
     ApplicationTools::displayResult("Number of sites", TextTools::toString(sites->getNumberOfSites()));
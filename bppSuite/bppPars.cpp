@@ -66,6 +66,10 @@ using namespace std;
 #include <Bpp/Phyl/OptimizationTools.h>
 #include <Bpp/Phyl/Io/Newick.h>
 
+// From bppsuite:
+#include "BootstrapTools.h"
+#include "SiteFilterTools.h"
+
 using namespace bpp;
 
 void help()
@@ -98,15 +102,20 @@ int main(int args, char ** argv)
   BppApplication bpppars(args, argv, "BppPars");
   bpppars.startTimer();
 
+  // Merge the replicates of a sharded bootstrap analysis:
+  if (BootstrapTools::mergeShards(bpppars.getParams()))
+  {
+    bpppars.done();
+    return 0;
+  }
+
 	Alphabet* alphabet = SequenceApplicationTools::getAlphabet(bpppars.getParams(), "", false);
   
   bool includeGaps = ApplicationTools::getBooleanParameter("use.gaps", bpppars.getParams(), false, "", false, false);
   ApplicationTools::displayBooleanResult("Use gaps", includeGaps);
 
-	VectorSiteContainer* allSites = SequenceApplicationTools::getSiteContainer(alphabet, bpppars.getParams());
 	
-	VectorSiteContainer* sites = SequenceApplicationTools::getSitesToAnalyse(* allSites, bpppars.getParams(), "", true, !includeGaps, true);
-	delete allSites;
+	VectorSiteContainer* sites = SiteFilterTools::getSitesToAnalyse(alphabet, bpppars.getParams(), "", true, !includeGaps, true);
   
   ApplicationTools::displayResult("Number of sequences", TextTools::toString(sites->getNumberOfSequences()));
   ApplicationTools::displayResult("Number of sites", TextTools::toString(sites->getNumberOfSites()));
@@ -157,7 +166,10 @@ int main(int args, char ** argv)
       tp = OptimizationTools::optimizeTreeNNI(tp, 1);
       initTree = &tp->getTree();
     }
-
+    unsigned int bsSeed = BootstrapTools::getSeed(bpppars.getParams(), 2);
+    ApplicationTools::displayResult("Bootstrap seed", bsSeed);
+    size_t bsBegin, bsEnd;
+    bool sharded = BootstrapTools::getShard(bpppars.getParams(), nbBS, bsBegin, bsEnd, 2);
     
     string bsTreesPath = ApplicationTools::getAFilePath("bootstrap.output.file", bpppars.getParams(), false, false);
     ofstream *out = 0;
@@ -166,19 +178,20 @@ int main(int args, char ** argv)
       ApplicationTools::displayResult("Bootstrap trees stored in file", bsTreesPath);
       out = new ofstream(bsTreesPath.c_str(), ios::out);
     }
+    else if (sharded)
+      throw Exception("'bootstrap.output.file' must be set when replicates are sharded.");
     Newick newick;
 
     ApplicationTools::displayTask("Bootstrapping", true);
-    vector<Tree*> bsTrees(nbBS);
-    for (unsigned int i = 0; i < nbBS; i++)
+    vector<Tree*> bsTrees(nbBS, 0);
+    for (size_t i = bsBegin; i < bsEnd; i++)
     {
-      ApplicationTools::displayGauge(i, nbBS - 1, '=');
-      VectorSiteContainer* sample = SiteContainerTools::bootstrapSites(*sites);
+      ApplicationTools::displayGauge(i - bsBegin + 1, bsEnd - bsBegin, '=');
+      VectorSiteContainer* sample = BootstrapTools::bootstrapSites(*sites, bsSeed, i);
       DRTreeParsimonyScore* tpRep = new DRTreeParsimonyScore(*initTree, *sample, false);
       tpRep = OptimizationTools::optimizeTreeNNI(tpRep, 0);
       bsTrees[i] = new TreeTemplate<Node>(tpRep->getTree());
-      if (out && i==0) newick.write(*bsTrees[i], bsTreesPath, true);
-      if (out && i>0) newick.write(*bsTrees[i], bsTreesPath, false);
+      if (out) newick.write(*bsTrees[i], bsTreesPath, i == bsBegin);
       delete tpRep;
       delete sample;
     }
@@ -187,14 +200,22 @@ int main(int args, char ** argv)
     ApplicationTools::displayTaskDone();
     
 
-    ApplicationTools::displayTask("Compute bootstrap values", true);
-    TreeTools::computeBootstrapValues(*tree, bsTrees);
-    ApplicationTools::displayTaskDone();
+    if (sharded)
+    {
+      //Bootstrap values are computed when merging all shards:
+      ApplicationTools::displayMessage("Shard done. Use 'bootstrap.merge' to compute bootstrap values.");
+    }
+    else
+    {
+      ApplicationTools::displayTask("Compute bootstrap values", true);
+      TreeTools::computeBootstrapValues(*tree, bsTrees);
+      ApplicationTools::displayTaskDone();
+
+      //Write resulting tree:
+      PhylogeneticsApplicationTools::writeTree(*tree, bpppars.getParams());
+    }
     for (unsigned int i = 0; i < nbBS; i++)
       delete bsTrees[i];
-
-    //Write resulting tree:
-    PhylogeneticsApplicationTools::writeTree(*tree, bpppars.getParams());
   }
 
 	delete sites;